@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Interrupt to task latency: SysTick is triggered by software and its
+ * handler wakes up a high priority task. The latency is the number of
+ * cycles from triggering the interrupt to the woken up task running.
+ * Results are stored in irq_latency and printed through semihosting.
+ */
+
+#include "critical.h"
+#include "cycles.h"
+#include "scheduler.h"
+#include "semihosting.h"
+#include <stdint.h>
+
+#define WAITER_TASK_ID      (1)
+#define ITERATIONS          (10000)
+
+struct latency_result_t {
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t count;
+};
+
+static volatile uint32_t trigger_cycles;
+
+volatile struct latency_result_t irq_latency = {
+    .min = UINT32_MAX,
+};
+
+void systick_handler(void)
+{
+    task_wake(WAITER_TASK_ID);
+}
+
+static void waiter_task(void)
+{
+    while (1) {
+        uint32_t latency;
+
+        /* Sleep until woken up by systick_handler */
+        scheduler_yield();
+
+        latency = cycles_read() - trigger_cycles;
+        if (latency < irq_latency.min)
+            irq_latency.min = latency;
+        if (latency > irq_latency.max)
+            irq_latency.max = latency;
+        irq_latency.total += latency;
+        irq_latency.count++;
+    }
+}
+
+TASK_DEFINE(waiter_task, WAITER_TASK_ID, waiter_task, 1024, 1, TASK_SCHEDULED);
+
+void main(void)
+{
+    unsigned int i;
+
+    NVIC_SetPriority(SysTick_IRQn, SCHEDULER_IRQ_PRIORITY);
+
+    /* Let waiter task go to sleep */
+    task_schedule(MAIN_TASK_ID);
+    scheduler_yield();
+
+    for (i = 0; i < ITERATIONS; ++i) {
+        trigger_cycles = cycles_read();
+        SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    }
+
+    if (irq_latency.count != ITERATIONS) {
+        semihosting_write("irq_latency failed: ");
+        semihosting_write_u32(irq_latency.count);
+        semihosting_write(" wakeups out of ");
+        semihosting_write_u32(ITERATIONS);
+        semihosting_write("\n");
+        semihosting_exit(1);
+    }
+
+    semihosting_write("irq_latency min ");
+    semihosting_write_u32(irq_latency.min);
+    semihosting_write(" avg ");
+    semihosting_write_u32(irq_latency.total / irq_latency.count);
+    semihosting_write(" max ");
+    semihosting_write_u32(irq_latency.max);
+    semihosting_write("\n");
+
+#ifdef MASKED_TIME
+    critical_sites_print();
+#endif
+
+    semihosting_exit(0);
+}
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cycles spent in each kernel operation, printed as CSV through
+ * semihosting: operation, number of tasks already queued, iterations,
+ * then min, avg and max cycles. The cost of reading the cycle counter
+ * is measured first and subtracted from every sample.
+ *
+ * The first switch to main task happens once per boot: it is measured
+ * from the cycle count recorded by scheduler_start.
+ */
+
+#include "critical.h"
+#include "cycles.h"
+#include "scheduler.h"
+#include "semihosting.h"
+#include "section.h"
+#include <stdint.h>
+
+#define ITERATIONS          (1000)
+#define STACK_SIZE          (1024)
+
+/* Tasks queued before the measured task in the task_schedule benchmark */
+#define FILLER_COUNT        (TASK_COUNT - 3)
+#define FIRST_FILLER_ID     (1)
+#define PING_TASK_ID        (TASK_COUNT - 2)
+#define PONG_TASK_ID        (TASK_COUNT - 1)
+
+struct stats_t {
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t count;
+};
+
+static DTCM_BSS uint8_t __attribute__((aligned(8))) stacks[TASK_COUNT][STACK_SIZE];
+
+static uint32_t read_overhead;
+
+static struct stats_t yield_stats;
+static volatile uint32_t yield_start;
+static volatile int yield_pending;
+static volatile int yield_fpu;
+static volatile float fpu_value;
+
+static void stats_reset(struct stats_t *stats)
+{
+    stats->min = UINT32_MAX;
+    stats->max = 0;
+    stats->total = 0;
+    stats->count = 0;
+}
+
+static void stats_add(struct stats_t *stats, uint32_t cycles)
+{
+    cycles = cycles > read_overhead ? cycles - read_overhead : 0;
+
+    if (cycles < stats->min)
+        stats->min = cycles;
+    if (cycles > stats->max)
+        stats->max = cycles;
+    stats->total += cycles;
+    stats->count++;
+}
+
+static void stats_print(const char *operation, unsigned int queued,
+                        const struct stats_t *stats)
+{
+    semihosting_write(operation);
+    semihosting_write(",");
+    semihosting_write_u32(queued);
+    semihosting_write(",");
+    semihosting_write_u32(stats->count);
+    semihosting_write(",");
+    semihosting_write_u32(stats->min);
+    semihosting_write(",");
+    semihosting_write_u32(stats->total / stats->count);
+    semihosting_write(",");
+    semihosting_write_u32(stats->max);
+    semihosting_write("\n");
+}
+
+static void idle_task(void)
+{
+    while (1)
+        scheduler_yield();
+}
+
+/*
+ * Ping and pong tasks schedule themselves and yield to each other until
+ * ITERATIONS switches are measured, then wake up main task.
+ */
+static void yield_task(void)
+{
+    /* The first switch to a task does not go through scheduler_yield */
+    yield_pending = 0;
+
+    while (1) {
+        uint32_t end = cycles_read();
+
+        if (yield_pending)
+            stats_add(&yield_stats, end - yield_start);
+
+        if (yield_stats.count < ITERATIONS) {
+            task_schedule(task_get_current());
+
+            /* Make the switch save and restore the FPU context */
+            if (yield_fpu)
+                fpu_value = fpu_value + 1.0f;
+
+            yield_pending = 1;
+            yield_start = cycles_read();
+        } else {
+            yield_pending = 0;
+            task_schedule(MAIN_TASK_ID);
+        }
+
+        scheduler_yield();
+    }
+}
+
+static void measure_read_overhead(void)
+{
+    unsigned int i;
+
+    read_overhead = UINT32_MAX;
+    for (i = 0; i < ITERATIONS; ++i) {
+        uint32_t start = cycles_read();
+        uint32_t cycles = cycles_read() - start;
+
+        if (cycles < read_overhead)
+            read_overhead = cycles;
+    }
+}
+
+static void measure_task_create(void)
+{
+    struct stats_t stats;
+    unsigned int i;
+
+    stats_reset(&stats);
+    for (i = 0; i < ITERATIONS; ++i) {
+        uint32_t start = cycles_read();
+
+        task_create(PONG_TASK_ID, idle_task, stacks[PONG_TASK_ID], STACK_SIZE);
+        stats_add(&stats, cycles_read() - start);
+    }
+
+    stats_print("task_create", 0, &stats);
+}
+
+static void measure_task_schedule(void)
+{
+    unsigned int queued, i, id;
+
+    /* All tasks have the same priority, so the new task goes last */
+    for (id = FIRST_FILLER_ID; id <= PING_TASK_ID; ++id) {
+        task_create(id, idle_task, stacks[id], STACK_SIZE);
+        task_set_priority(id, 1);
+    }
+
+    for (queued = 0; queued <= FILLER_COUNT; ++queued) {
+        struct stats_t stats;
+
+        stats_reset(&stats);
+        for (i = 0; i < ITERATIONS; ++i) {
+            uint32_t start;
+
+            for (id = FIRST_FILLER_ID; id < FIRST_FILLER_ID + queued; ++id)
+                task_schedule(id);
+
+            start = cycles_read();
+            task_schedule(PING_TASK_ID);
+            stats_add(&stats, cycles_read() - start);
+
+            /* Let queued tasks run and stop, main task has a lower priority */
+            task_schedule(MAIN_TASK_ID);
+            scheduler_yield();
+        }
+
+        stats_print("task_schedule", queued, &stats);
+    }
+}
+
+static void measure_yield(const char *operation, int fpu)
+{
+    task_create(PING_TASK_ID, yield_task, stacks[PING_TASK_ID], STACK_SIZE);
+    task_create(PONG_TASK_ID, yield_task, stacks[PONG_TASK_ID], STACK_SIZE);
+    if (!fpu) {
+        task_set_integer_only(PING_TASK_ID);
+        task_set_integer_only(PONG_TASK_ID);
+    }
+    task_set_priority(PING_TASK_ID, 1);
+    task_set_priority(PONG_TASK_ID, 1);
+
+    stats_reset(&yield_stats);
+    yield_fpu = fpu;
+    task_schedule(PING_TASK_ID);
+    task_schedule(PONG_TASK_ID);
+
+    /* Main task is scheduled again by the task which finishes first */
+    scheduler_yield();
+
+    stats_print(operation, 0, &yield_stats);
+}
+
+void main(void)
+{
+    uint32_t first_switch = cycles_read() - scheduler_get_boot_cycles();
+    struct stats_t stats;
+
+    measure_read_overhead();
+
+    semihosting_write("operation,queued,iterations,min,avg,max\n");
+
+    stats_reset(&stats);
+    stats_add(&stats, first_switch);
+    stats_print("first_switch", 0, &stats);
+
+    measure_task_create();
+    measure_task_schedule();
+    measure_yield("yield", 0);
+#ifdef __FPU_PRESENT
+    measure_yield("yield_fpu", 1);
+#endif
+
+#ifdef MASKED_TIME
+    critical_sites_print();
+#endif
+
+    semihosting_exit(0);
+}
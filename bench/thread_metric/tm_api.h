@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TM_API_H
+#define TM_API_H
+
+/*
+ * Thread-Metric porting layer API. Each tm_* benchmark implements
+ * tm_main and tm_interrupt_handler on top of it.
+ *
+ * Thread priorities range from 1 (highest) to 31 (lowest).
+ */
+
+#define TM_SUCCESS          (0)
+#define TM_ERROR            (1)
+
+/* Length of a reporting window, in seconds */
+#ifndef TM_TEST_DURATION
+#define TM_TEST_DURATION    (30)
+#endif
+
+void tm_main(void);
+void tm_interrupt_handler(void);
+
+int tm_initialize(void (*test_initialization_function)(void));
+
+int tm_thread_create(int thread_id, int priority, void (*entry_function)(void));
+int tm_thread_resume(int thread_id);
+int tm_thread_suspend(int thread_id);
+void tm_thread_relinquish(void);
+void tm_thread_sleep(int seconds);
+
+int tm_queue_create(int queue_id);
+int tm_queue_send(int queue_id, unsigned long *message_ptr);
+int tm_queue_receive(int queue_id, unsigned long *message_ptr);
+
+int tm_semaphore_create(int semaphore_id);
+int tm_semaphore_get(int semaphore_id);
+int tm_semaphore_put(int semaphore_id);
+
+int tm_memory_pool_create(int pool_id);
+int tm_memory_pool_allocate(int pool_id, unsigned char **memory_ptr);
+int tm_memory_pool_deallocate(int pool_id, unsigned char *memory_ptr);
+
+void tm_cause_interrupt(void);
+
+/**
+ * @brief Print the result of a reporting window
+ *
+ * @param[in] name Test name
+ * @param[in] relative_time Seconds since the test started
+ * @param[in] period_total Operations during the window
+ * @param[in] error Non-zero if the test counters are inconsistent
+ */
+void tm_report(const char *name, unsigned long relative_time,
+               unsigned long period_total, int error);
+
+#endif
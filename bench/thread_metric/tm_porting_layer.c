@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Thread-Metric porting layer. Thread n is task n + 1, main task runs
+ * the test initialization and then stops. SysTick provides the time base
+ * of tm_thread_sleep, and tm_cause_interrupt pends a vendor interrupt
+ * which calls tm_interrupt_handler.
+ */
+
+#include "irq.h"
+#include "mpmc_queue.h"
+#include "scheduler.h"
+#include "section.h"
+#include "semaphore.h"
+#include "semihosting.h"
+#include "tm_api.h"
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TM_THREAD_COUNT         (TASK_COUNT - 1)
+#define TM_STACK_SIZE           (1024)
+
+#define TM_QUEUE_COUNT          (1)
+#define TM_QUEUE_LENGTH         (128)
+#define TM_MESSAGE_SIZE         (16)
+
+#define TM_SEMAPHORE_COUNT      (1)
+
+#define TM_POOL_COUNT           (1)
+#define TM_POOL_SIZE            (2048)
+#define TM_BLOCK_SIZE           (128)
+#define TM_BLOCK_COUNT          (TM_POOL_SIZE / TM_BLOCK_SIZE)
+
+#define TM_TICK_RATE            (100)
+
+/* Interrupt raised by tm_cause_interrupt, not used by the benchmarks */
+#define TM_INTERRUPT_IRQ        ((IRQn_Type)0)
+
+struct tm_queue_t {
+    struct mpmc_queue_t free;
+    struct mpmc_queue_t full;
+    struct mpmc_cell_t free_cells[TM_QUEUE_LENGTH];
+    struct mpmc_cell_t full_cells[TM_QUEUE_LENGTH];
+    unsigned long messages[TM_QUEUE_LENGTH][TM_MESSAGE_SIZE / sizeof(unsigned long)];
+};
+
+struct tm_pool_t {
+    struct mpmc_queue_t free;
+    struct mpmc_cell_t free_cells[TM_BLOCK_COUNT];
+    unsigned char __attribute__((aligned(8))) blocks[TM_BLOCK_COUNT][TM_BLOCK_SIZE];
+};
+
+static DTCM_BSS uint8_t __attribute__((aligned(8))) tm_stacks[TM_THREAD_COUNT][TM_STACK_SIZE];
+static struct tm_queue_t tm_queues[TM_QUEUE_COUNT];
+static struct semaphore_t tm_semaphores[TM_SEMAPHORE_COUNT];
+static struct tm_pool_t tm_pools[TM_POOL_COUNT];
+
+static volatile uint32_t tm_ticks;
+static volatile uint32_t tm_wake_tick;
+static volatile int tm_sleeping_task = -1;
+
+static void tm_tick_handler(void)
+{
+    int task = tm_sleeping_task;
+
+    tm_ticks++;
+    if (task >= 0 && (int32_t)(tm_ticks - tm_wake_tick) >= 0)
+        task_wake(task);
+}
+
+static void tm_irq_handler(void)
+{
+    tm_interrupt_handler();
+}
+
+void main(void)
+{
+    irq_register(SysTick_IRQn, tm_tick_handler);
+    NVIC_SetPriority(SysTick_IRQn, SCHEDULER_IRQ_PRIORITY);
+    SysTick_Config(CORE_CLOCK / TM_TICK_RATE);
+
+    irq_register(TM_INTERRUPT_IRQ, tm_irq_handler);
+    NVIC_SetPriority(TM_INTERRUPT_IRQ, SCHEDULER_IRQ_PRIORITY);
+    NVIC_EnableIRQ(TM_INTERRUPT_IRQ);
+
+    tm_main();
+}
+
+int tm_initialize(void (*test_initialization_function)(void))
+{
+    /* Threads resumed during initialization must not preempt main task */
+    task_set_priority(MAIN_TASK_ID, UINT_MAX);
+    test_initialization_function();
+    task_set_priority(MAIN_TASK_ID, 0);
+
+    /* Main task is never scheduled again */
+    while (1)
+        scheduler_yield();
+
+    return TM_SUCCESS;
+}
+
+int tm_thread_create(int thread_id, int priority, void (*entry_function)(void))
+{
+    if (thread_id < 0 || thread_id >= TM_THREAD_COUNT || priority < 1 || priority > 31)
+        return TM_ERROR;
+
+    task_create(thread_id + 1, entry_function, tm_stacks[thread_id], TM_STACK_SIZE);
+    task_set_priority(thread_id + 1, 32 - priority);
+
+    return TM_SUCCESS;
+}
+
+int tm_thread_resume(int thread_id)
+{
+    if (thread_id < 0 || thread_id >= TM_THREAD_COUNT)
+        return TM_ERROR;
+
+    task_wake(thread_id + 1);
+
+    return TM_SUCCESS;
+}
+
+int tm_thread_suspend(int thread_id)
+{
+    /* Only the running thread can suspend itself */
+    if ((unsigned int)thread_id + 1 != task_get_current())
+        return TM_ERROR;
+
+    scheduler_yield();
+
+    return TM_SUCCESS;
+}
+
+void tm_thread_relinquish(void)
+{
+    task_schedule(task_get_current());
+    scheduler_yield();
+}
+
+void tm_thread_sleep(int seconds)
+{
+    tm_wake_tick = tm_ticks + seconds * TM_TICK_RATE;
+    tm_sleeping_task = task_get_current();
+
+    while ((int32_t)(tm_ticks - tm_wake_tick) < 0)
+        scheduler_yield();
+
+    tm_sleeping_task = -1;
+}
+
+int tm_queue_create(int queue_id)
+{
+    struct tm_queue_t *queue;
+    unsigned int i;
+
+    if (queue_id < 0 || queue_id >= TM_QUEUE_COUNT)
+        return TM_ERROR;
+
+    queue = &tm_queues[queue_id];
+    mpmc_queue_init(&queue->free, queue->free_cells, TM_QUEUE_LENGTH);
+    mpmc_queue_init(&queue->full, queue->full_cells, TM_QUEUE_LENGTH);
+    for (i = 0; i < TM_QUEUE_LENGTH; ++i)
+        mpmc_queue_push(&queue->free, queue->messages[i]);
+
+    return TM_SUCCESS;
+}
+
+int tm_queue_send(int queue_id, unsigned long *message_ptr)
+{
+    struct tm_queue_t *queue = &tm_queues[queue_id];
+    void *message;
+
+    if (mpmc_queue_pop(&queue->free, &message))
+        return TM_ERROR;
+
+    memcpy(message, message_ptr, TM_MESSAGE_SIZE);
+    mpmc_queue_push(&queue->full, message);
+
+    return TM_SUCCESS;
+}
+
+int tm_queue_receive(int queue_id, unsigned long *message_ptr)
+{
+    struct tm_queue_t *queue = &tm_queues[queue_id];
+    void *message;
+
+    if (mpmc_queue_pop(&queue->full, &message))
+        return TM_ERROR;
+
+    memcpy(message_ptr, message, TM_MESSAGE_SIZE);
+    mpmc_queue_push(&queue->free, message);
+
+    return TM_SUCCESS;
+}
+
+int tm_semaphore_create(int semaphore_id)
+{
+    if (semaphore_id < 0 || semaphore_id >= TM_SEMAPHORE_COUNT)
+        return TM_ERROR;
+
+    semaphore_init(&tm_semaphores[semaphore_id], 1);
+
+    return TM_SUCCESS;
+}
+
+int tm_semaphore_get(int semaphore_id)
+{
+    return semaphore_try_take(&tm_semaphores[semaphore_id]) ? TM_ERROR : TM_SUCCESS;
+}
+
+int tm_semaphore_put(int semaphore_id)
+{
+    semaphore_give(&tm_semaphores[semaphore_id]);
+
+    return TM_SUCCESS;
+}
+
+int tm_memory_pool_create(int pool_id)
+{
+    struct tm_pool_t *pool;
+    unsigned int i;
+
+    if (pool_id < 0 || pool_id >= TM_POOL_COUNT)
+        return TM_ERROR;
+
+    pool = &tm_pools[pool_id];
+    mpmc_queue_init(&pool->free, pool->free_cells, TM_BLOCK_COUNT);
+    for (i = 0; i < TM_BLOCK_COUNT; ++i)
+        mpmc_queue_push(&pool->free, pool->blocks[i]);
+
+    return TM_SUCCESS;
+}
+
+int tm_memory_pool_allocate(int pool_id, unsigned char **memory_ptr)
+{
+    void *block;
+
+    if (mpmc_queue_pop(&tm_pools[pool_id].free, &block))
+        return TM_ERROR;
+
+    *memory_ptr = block;
+
+    return TM_SUCCESS;
+}
+
+int tm_memory_pool_deallocate(int pool_id, unsigned char *memory_ptr)
+{
+    return mpmc_queue_push(&tm_pools[pool_id].free, memory_ptr) ? TM_ERROR : TM_SUCCESS;
+}
+
+void tm_cause_interrupt(void)
+{
+    NVIC_SetPendingIRQ(TM_INTERRUPT_IRQ);
+
+    /* Make sure the interrupt is taken before returning */
+    __DSB();
+    __ISB();
+}
+
+void tm_report(const char *name, unsigned long relative_time,
+               unsigned long period_total, int error)
+{
+    semihosting_write("**** Thread-Metric ");
+    semihosting_write(name);
+    semihosting_write(" Test **** Relative Time: ");
+    semihosting_write_u32(relative_time);
+    semihosting_write("\n");
+
+    if (error) {
+        semihosting_write("ERROR: Invalid counter value(s). ");
+        semihosting_write(name);
+        semihosting_write(" test is not working\n");
+    }
+
+    semihosting_write("Time Period Total:  ");
+    semihosting_write_u32(period_total);
+    semihosting_write("\n\n");
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Interrupt preemption processing: a thread triggers an interrupt whose
+ * handler resumes a higher priority thread. The higher priority thread
+ * runs as soon as the handler returns, then suspends itself.
+ */
+
+#include "tm_api.h"
+
+static volatile unsigned long counters[2];
+static volatile unsigned long handler_counter;
+
+static void tm_interrupt_preemption_thread_0(void)
+{
+    while (1) {
+        tm_cause_interrupt();
+        counters[0]++;
+    }
+}
+
+static void tm_interrupt_preemption_thread_1(void)
+{
+    while (1) {
+        counters[1]++;
+        tm_thread_suspend(1);
+    }
+}
+
+static void tm_interrupt_preemption_thread_report(void)
+{
+    unsigned long last_total = 0;
+    unsigned long relative_time = 0;
+
+    while (1) {
+        unsigned long total, handled, preempted, interrupted;
+
+        tm_thread_sleep(TM_TEST_DURATION);
+        relative_time += TM_TEST_DURATION;
+
+        interrupted = counters[0];
+        preempted = counters[1];
+        handled = handler_counter;
+        total = interrupted + preempted + handled;
+
+        tm_report("Interrupt Preemption Processing", relative_time, total - last_total,
+                  handled - preempted > 1 || handled - interrupted > 1);
+        last_total = total;
+    }
+}
+
+static void tm_interrupt_preemption_processing_initialize(void)
+{
+    tm_thread_create(0, 10, tm_interrupt_preemption_thread_0);
+    tm_thread_create(1, 9, tm_interrupt_preemption_thread_1);
+    tm_thread_resume(0);
+
+    tm_thread_create(5, 2, tm_interrupt_preemption_thread_report);
+    tm_thread_resume(5);
+}
+
+void tm_main(void)
+{
+    tm_initialize(tm_interrupt_preemption_processing_initialize);
+}
+
+void tm_interrupt_handler(void)
+{
+    handler_counter++;
+    tm_thread_resume(1);
+}
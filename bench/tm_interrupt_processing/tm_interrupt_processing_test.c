@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Interrupt processing: a thread triggers an interrupt whose handler
+ * puts a semaphore, then gets the semaphore back.
+ */
+
+#include "tm_api.h"
+
+static volatile unsigned long thread_counter;
+static volatile unsigned long handler_counter;
+
+static void tm_interrupt_thread(void)
+{
+    /* The semaphore is created available, take it once */
+    tm_semaphore_get(0);
+
+    while (1) {
+        tm_cause_interrupt();
+
+        if (tm_semaphore_get(0) != TM_SUCCESS)
+            break;
+
+        thread_counter++;
+    }
+
+    while (1)
+        tm_thread_suspend(0);
+}
+
+static void tm_interrupt_thread_report(void)
+{
+    unsigned long last_total = 0;
+    unsigned long relative_time = 0;
+
+    while (1) {
+        unsigned long total, handled;
+
+        tm_thread_sleep(TM_TEST_DURATION);
+        relative_time += TM_TEST_DURATION;
+
+        total = thread_counter;
+        handled = handler_counter;
+
+        /* The report may run between an interrupt and its processing */
+        tm_report("Interrupt Processing", relative_time, total - last_total,
+                  handled - total > 1);
+        last_total = total;
+    }
+}
+
+static void tm_interrupt_processing_initialize(void)
+{
+    tm_semaphore_create(0);
+
+    tm_thread_create(0, 10, tm_interrupt_thread);
+    tm_thread_resume(0);
+
+    tm_thread_create(5, 2, tm_interrupt_thread_report);
+    tm_thread_resume(5);
+}
+
+void tm_main(void)
+{
+    tm_initialize(tm_interrupt_processing_initialize);
+}
+
+void tm_interrupt_handler(void)
+{
+    handler_counter++;
+    tm_semaphore_put(0);
+}
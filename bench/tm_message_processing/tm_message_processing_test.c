@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Message processing: a thread sends a 16-byte message to a queue and
+ * receives it back.
+ */
+
+#include "tm_api.h"
+
+static volatile unsigned long counter;
+
+static void tm_message_thread(void)
+{
+    unsigned long message_send[4] = { 0x11112222, 0x33334444, 0x55556666, 0 };
+    unsigned long message_receive[4];
+
+    while (1) {
+        message_send[3] = counter;
+
+        tm_queue_send(0, message_send);
+        tm_queue_receive(0, message_receive);
+
+        if (message_receive[3] != message_send[3])
+            break;
+
+        counter++;
+    }
+
+    while (1)
+        tm_thread_suspend(0);
+}
+
+static void tm_message_thread_report(void)
+{
+    unsigned long last_total = 0;
+    unsigned long relative_time = 0;
+
+    while (1) {
+        unsigned long total;
+
+        tm_thread_sleep(TM_TEST_DURATION);
+        relative_time += TM_TEST_DURATION;
+
+        total = counter;
+        tm_report("Message Processing", relative_time, total - last_total,
+                  total == last_total);
+        last_total = total;
+    }
+}
+
+static void tm_message_processing_initialize(void)
+{
+    tm_queue_create(0);
+
+    tm_thread_create(0, 10, tm_message_thread);
+    tm_thread_resume(0);
+
+    tm_thread_create(5, 2, tm_message_thread_report);
+    tm_thread_resume(5);
+}
+
+void tm_main(void)
+{
+    tm_initialize(tm_message_processing_initialize);
+}
+
+void tm_interrupt_handler(void)
+{
+}
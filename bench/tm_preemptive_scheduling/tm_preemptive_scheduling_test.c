@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Preemptive scheduling: thread 0 has the lowest priority and resumes
+ * thread 1, which preempts it and resumes thread 2, and so on up to
+ * thread 4. Each preempting thread increments its counter and suspends
+ * itself, so that the previous thread runs again.
+ */
+
+#include "tm_api.h"
+
+#define THREAD_COUNT    (5)
+
+static volatile unsigned long counters[THREAD_COUNT];
+
+static void tm_preemptive_thread_0(void)
+{
+    while (1) {
+        tm_thread_resume(1);
+        counters[0]++;
+    }
+}
+
+static void tm_preemptive_thread(int id)
+{
+    while (1) {
+        if (id < THREAD_COUNT - 1)
+            tm_thread_resume(id + 1);
+        counters[id]++;
+        tm_thread_suspend(id);
+    }
+}
+
+static void tm_preemptive_thread_1(void) { tm_preemptive_thread(1); }
+static void tm_preemptive_thread_2(void) { tm_preemptive_thread(2); }
+static void tm_preemptive_thread_3(void) { tm_preemptive_thread(3); }
+static void tm_preemptive_thread_4(void) { tm_preemptive_thread(4); }
+
+static void tm_preemptive_thread_report(void)
+{
+    unsigned long last_total = 0;
+    unsigned long relative_time = 0;
+
+    while (1) {
+        unsigned long total = 0, min = ~0UL, max = 0;
+        int i;
+
+        tm_thread_sleep(TM_TEST_DURATION);
+        relative_time += TM_TEST_DURATION;
+
+        for (i = 0; i < THREAD_COUNT; ++i) {
+            unsigned long counter = counters[i];
+
+            total += counter;
+            if (counter < min)
+                min = counter;
+            if (counter > max)
+                max = counter;
+        }
+
+        tm_report("Preemptive Scheduling", relative_time, total - last_total, max - min > 1);
+        last_total = total;
+    }
+}
+
+static void tm_preemptive_scheduling_initialize(void)
+{
+    static void (* const entries[THREAD_COUNT])(void) = {
+        tm_preemptive_thread_0,
+        tm_preemptive_thread_1,
+        tm_preemptive_thread_2,
+        tm_preemptive_thread_3,
+        tm_preemptive_thread_4,
+    };
+    int i;
+
+    /* Thread 0 has priority 10, thread 4 has priority 6 */
+    for (i = 0; i < THREAD_COUNT; ++i)
+        tm_thread_create(i, 10 - i, entries[i]);
+    tm_thread_resume(0);
+
+    tm_thread_create(THREAD_COUNT, 2, tm_preemptive_thread_report);
+    tm_thread_resume(THREAD_COUNT);
+}
+
+void tm_main(void)
+{
+    tm_initialize(tm_preemptive_scheduling_initialize);
+}
+
+void tm_interrupt_handler(void)
+{
+}
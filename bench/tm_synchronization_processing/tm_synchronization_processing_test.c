@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Synchronization processing: a thread gets and puts a semaphore.
+ */
+
+#include "tm_api.h"
+
+static volatile unsigned long counter;
+
+static void tm_synchronization_thread(void)
+{
+    while (1) {
+        if (tm_semaphore_get(0) != TM_SUCCESS)
+            break;
+        if (tm_semaphore_put(0) != TM_SUCCESS)
+            break;
+
+        counter++;
+    }
+
+    while (1)
+        tm_thread_suspend(0);
+}
+
+static void tm_synchronization_thread_report(void)
+{
+    unsigned long last_total = 0;
+    unsigned long relative_time = 0;
+
+    while (1) {
+        unsigned long total;
+
+        tm_thread_sleep(TM_TEST_DURATION);
+        relative_time += TM_TEST_DURATION;
+
+        total = counter;
+        tm_report("Synchronization Processing", relative_time, total - last_total,
+                  total == last_total);
+        last_total = total;
+    }
+}
+
+static void tm_synchronization_processing_initialize(void)
+{
+    tm_semaphore_create(0);
+
+    tm_thread_create(0, 10, tm_synchronization_thread);
+    tm_thread_resume(0);
+
+    tm_thread_create(5, 2, tm_synchronization_thread_report);
+    tm_thread_resume(5);
+}
+
+void tm_main(void)
+{
+    tm_initialize(tm_synchronization_processing_initialize);
+}
+
+void tm_interrupt_handler(void)
+{
+}
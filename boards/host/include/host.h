@@ -0,0 +1,154 @@
+/*
+ * Device header of the host port. It emulates the few CMSIS functions
+ * used by the portable kernel code, on top of the interrupt model of
+ * port_host.c:
+ *  - BASEPRI and PRIMASK are variables. Simulated interrupts are delivered
+ *    by signals, and deferred while masked.
+ *  - LDREX/STREX keep an exclusive flag, cleared when an interrupt is
+ *    taken, and store with a compare and exchange.
+ */
+
+#ifndef __HOST_H
+#define __HOST_H
+
+#include <stdint.h>
+
+#define __NVIC_PRIO_BITS          4
+
+/* Number of simulated interrupts */
+#define HOST_IRQ_COUNT            (32)
+
+/* Task descriptors, see TASK_DEFINE */
+#define TASK_SECTION              "task"
+#define _stask                    __start_task
+#define _etask                    __stop_task
+
+/* Both are NULL when no task is declared, and the section is missing */
+#pragma weak __start_task
+#pragma weak __stop_task
+
+/* The application main function is the main task, not the process entry */
+#define main                      task_main
+
+extern volatile uint32_t host_basepri;
+extern volatile uint32_t host_primask;
+extern volatile uint32_t host_ipsr;
+extern volatile uint32_t host_pending;     /* Bit n set if interrupt n is pending */
+extern volatile uint32_t host_pendsv;      /* Context switch pending */
+extern volatile uint32_t host_exclusive;
+extern volatile uint64_t host_exclusive_value;
+
+/* Deliver pending interrupts, called when they are unmasked */
+void host_unmasked(void);
+
+/**
+ * @brief Register the handler of a simulated interrupt
+ *
+ * @param[in] irq Less than HOST_IRQ_COUNT
+ * @param[in] handler
+ */
+void host_irq_register(unsigned int irq, void (*handler)(void));
+
+/**
+ * @brief Raise a simulated interrupt
+ *
+ * Can be called from tasks, interrupt handlers and other threads.
+ *
+ * @param[in] irq
+ */
+void host_irq_raise(unsigned int irq);
+
+/**
+ * @brief Raise a simulated interrupt periodically
+ *
+ * @param[in] irq
+ * @param[in] period_us Period in microseconds
+ */
+void host_timer_start(unsigned int irq, uint32_t period_us);
+
+static inline void host_check_pending(void)
+{
+    if ((host_pending || host_pendsv) && !host_basepri && !host_primask && !host_ipsr)
+        host_unmasked();
+}
+
+static inline uint32_t __get_BASEPRI(void)
+{
+    return host_basepri;
+}
+
+static inline void __set_BASEPRI(uint32_t value)
+{
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    host_basepri = value;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    host_check_pending();
+}
+
+static inline void __set_BASEPRI_MAX(uint32_t value)
+{
+    if (value && (!host_basepri || value < host_basepri))
+        host_basepri = value;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t __get_IPSR(void)
+{
+    return host_ipsr;
+}
+
+static inline void __DMB(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __DSB(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __ISB(void)
+{
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t __CLZ(uint32_t value)
+{
+    return value ? (uint32_t)__builtin_clz(value) : 32;
+}
+
+static inline void __CLREX(void)
+{
+    host_exclusive = 0;
+}
+
+#define HOST_DEFINE_EXCLUSIVE(suffix, type)                                 \
+static inline type __LDREX##suffix(volatile type *ptr)                      \
+{                                                                           \
+    type value = *ptr;                                                      \
+                                                                            \
+    host_exclusive_value = value;                                           \
+    host_exclusive = 1;                                                     \
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);                                \
+    return value;                                                           \
+}                                                                           \
+                                                                            \
+static inline uint32_t __STREX##suffix(type value, volatile type *ptr)      \
+{                                                                           \
+    type expected = (type)host_exclusive_value;                             \
+                                                                            \
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);                                \
+    if (!host_exclusive)                                                    \
+        return 1;                                                           \
+    host_exclusive = 0;                                                     \
+                                                                            \
+    /* An interrupt may have changed the value after the check */           \
+    return !__atomic_compare_exchange_n(ptr, &expected, value, 0,           \
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);\
+}
+
+HOST_DEFINE_EXCLUSIVE(B, uint8_t)
+HOST_DEFINE_EXCLUSIVE(W, uint32_t)
+HOST_DEFINE_EXCLUSIVE(D, uint64_t)
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Device header for the Cortex-M7 MPS2 FPGA image AN500 emulated by QEMU
+ * as mps2-an500.
+ * Only the core configuration, interrupt numbers and the CMSDK timer
+ * used as cycle counter are defined.
+ */
+
+#ifndef __MPS2_AN500_H
+#define __MPS2_AN500_H
+
+#define __CM7_REV                 0x0100U
+#define __MPU_PRESENT             1
+#define __NVIC_PRIO_BITS          3
+#define __Vendor_SysTickConfig    0
+#define __FPU_PRESENT             1
+#define __ICACHE_PRESENT          0       /* Caches are not emulated by QEMU */
+#define __DCACHE_PRESENT          0
+#define __DTCM_PRESENT            0
+
+typedef enum
+{
+  NonMaskableInt_IRQn         = -14,
+  HardFault_IRQn              = -13,
+  MemoryManagement_IRQn       = -12,
+  BusFault_IRQn               = -11,
+  UsageFault_IRQn             = -10,
+  SVCall_IRQn                 = -5,
+  DebugMonitor_IRQn           = -4,
+  PendSV_IRQn                 = -2,
+  SysTick_IRQn                = -1,
+  UARTRX0_IRQn                = 0,
+  UARTTX0_IRQn                = 1,
+  UARTRX1_IRQn                = 2,
+  UARTTX1_IRQn                = 3,
+  UARTRX2_IRQn                = 4,
+  UARTTX2_IRQn                = 5,
+  GPIO0ALL_IRQn               = 6,
+  GPIO1ALL_IRQn               = 7,
+  TIMER0_IRQn                 = 8,
+  TIMER1_IRQn                 = 9,
+  DUALTIMER_IRQn              = 10,
+} IRQn_Type;
+
+#include "core_cm7.h"
+
+typedef struct
+{
+  __IO uint32_t CTRL;
+  __IO uint32_t VALUE;
+  __IO uint32_t RELOAD;
+  __IO uint32_t INTCLEAR;
+} CMSDK_TIMER_TypeDef;
+
+#define CMSDK_TIMER_CTRL_EN_Msk   (1UL << 0)
+
+#define CMSDK_TIMER0_BASE         (0x40000000UL)
+#define CMSDK_TIMER1_BASE         (0x40001000UL)
+
+#define CMSDK_TIMER0              ((CMSDK_TIMER_TypeDef *)CMSDK_TIMER0_BASE)
+#define CMSDK_TIMER1              ((CMSDK_TIMER_TypeDef *)CMSDK_TIMER1_BASE)
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "active_object.h"
+#include "atomic.h"
+#include "scheduler.h"
+#include <stddef.h>
+
+static struct active_object_t *active_objects[ACTIVE_OBJECT_COUNT];
+
+/* Bit n set if active object of priority n has pending events */
+static volatile uint32_t ready_set;
+
+/* Task running active objects, -1 until active_object_run is called */
+static volatile int runner_task = -1;
+
+void active_object_init(struct active_object_t *ao, unsigned int priority,
+                        void (*dispatch)(struct active_object_t *ao, const struct ao_event_t *event),
+                        struct mpmc_cell_t *cells, uint32_t length)
+{
+    ao->dispatch = dispatch;
+    ao->priority = priority;
+    mpmc_queue_init(&ao->queue, cells, length);
+
+    active_objects[priority] = ao;
+}
+
+int active_object_post(struct active_object_t *ao, const struct ao_event_t *event)
+{
+    int task;
+
+    if (mpmc_queue_push(&ao->queue, (void *)event))
+        return -1;
+
+    atomic_set_bits_u32(&ready_set, 1U << ao->priority);
+
+    task = runner_task;
+    if (task >= 0)
+        task_wake(task);
+
+    return 0;
+}
+
+noreturn void active_object_run(void)
+{
+    runner_task = task_get_current();
+
+    while (1) {
+        struct active_object_t *ao;
+        uint32_t ready = ready_set;
+        void *event;
+
+        if (!ready) {
+            /* Sleep until an event is posted */
+            scheduler_yield();
+            continue;
+        }
+
+        ao = active_objects[31 - __CLZ(ready)];
+        if (mpmc_queue_pop(&ao->queue, &event)) {
+            /*
+             * The queue is empty. An event posted right before the ready
+             * bit is cleared would be missed, so check the queue again.
+             */
+            atomic_clear_bits_u32(&ready_set, 1U << ao->priority);
+            if (mpmc_queue_pop(&ao->queue, &event))
+                continue;
+
+            atomic_set_bits_u32(&ready_set, 1U << ao->priority);
+        }
+
+        ao->dispatch(ao, event);
+    }
+}
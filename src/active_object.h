@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACTIVE_OBJECT_H
+#define ACTIVE_OBJECT_H
+
+#include "mpmc_queue.h"
+#include <stdint.h>
+#include <stdnoreturn.h>
+
+/*
+ * Active objects react to events with a dispatch function which runs to
+ * completion. They do not have their own stack: all active objects are
+ * run by the task calling active_object_run, highest priority first.
+ *
+ * Events are passed by pointer and never copied. An event type embeds
+ * struct ao_event_t as its first member, and the event must stay valid
+ * until it has been dispatched.
+ */
+
+#define ACTIVE_OBJECT_COUNT     (32)
+
+struct ao_event_t {
+    uint16_t signal;
+};
+
+struct active_object_t {
+    void (*dispatch)(struct active_object_t *ao, const struct ao_event_t *event);
+    struct mpmc_queue_t queue;
+    unsigned int priority;
+};
+
+/**
+ * @brief Initialize an active object
+ *
+ * @param[out] ao
+ * @param[in] priority Must be less than ACTIVE_OBJECT_COUNT and unique
+ * @param[in] dispatch Called for each event posted to the active object
+ * @param[in] cells Storage for the event queue
+ * @param[in] length Number of cells, must be a power of two
+ */
+void active_object_init(struct active_object_t *ao, unsigned int priority,
+                        void (*dispatch)(struct active_object_t *ao, const struct ao_event_t *event),
+                        struct mpmc_cell_t *cells, uint32_t length);
+
+/**
+ * @brief Post an event to an active object
+ *
+ * Never masks interrupts, can be called from any interrupt handler and
+ * from tasks.
+ *
+ * @param[in] ao
+ * @param[in] event
+ * @return 0 if successful, -1 if the event queue is full
+ */
+int active_object_post(struct active_object_t *ao, const struct ao_event_t *event);
+
+/**
+ * @brief Run active objects in the calling task
+ *
+ * The task yields when no active object has pending events, and is woken
+ * up when an event is posted.
+ */
+noreturn void active_object_run(void);
+
+#endif
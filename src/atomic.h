@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <stdint.h>
+
+/*
+ * Lock-free atomic operations built on LDREX/STREX. They never mask
+ * interrupts, so they can be used from any interrupt handler. An
+ * exception between LDREX and STREX clears the exclusive monitor and
+ * the operation is simply retried.
+ *
+ * All operations are full memory barriers: DMB orders them with respect
+ * to other bus masters such as DMA controllers.
+ */
+
+#define ATOMIC_DEFINE_RMW(name, suffix, type, ldrex, strex, op)             \
+static inline type atomic_##name##_##suffix(volatile type *ptr, type value) \
+{                                                                           \
+    type old;                                                               \
+                                                                            \
+    __DMB();                                                                \
+    do {                                                                    \
+        old = ldrex(ptr);                                                   \
+    } while (strex((type)(op), ptr));                                       \
+    __DMB();                                                                \
+                                                                            \
+    return old;                                                             \
+}
+
+#define ATOMIC_DEFINE_CAS(suffix, type, ldrex, strex)                       \
+static inline type atomic_compare_exchange_##suffix(volatile type *ptr,     \
+                                                    type expected,          \
+                                                    type desired)           \
+{                                                                           \
+    type old;                                                               \
+                                                                            \
+    __DMB();                                                                \
+    do {                                                                    \
+        old = ldrex(ptr);                                                   \
+        if (old != expected) {                                              \
+            __CLREX();                                                      \
+            break;                                                          \
+        }                                                                   \
+    } while (strex(desired, ptr));                                          \
+    __DMB();                                                                \
+                                                                            \
+    return old;                                                             \
+}
+
+/*
+ * atomic_fetch_add_*(ptr, value): add value, return previous value
+ * atomic_exchange_*(ptr, value): store value, return previous value
+ * atomic_set_bits_*(ptr, mask): set bits of mask, return previous value
+ * atomic_clear_bits_*(ptr, mask): clear bits of mask, return previous value
+ * atomic_compare_exchange_*(ptr, expected, desired): store desired if
+ *     the current value is expected, return previous value in any case
+ *
+ * Suffixes: u32, u8, and ptr for exchange and compare_exchange.
+ */
+
+ATOMIC_DEFINE_RMW(fetch_add, u32, uint32_t, __LDREXW, __STREXW, old + value)
+ATOMIC_DEFINE_RMW(exchange, u32, uint32_t, __LDREXW, __STREXW, value)
+ATOMIC_DEFINE_RMW(set_bits, u32, uint32_t, __LDREXW, __STREXW, old | value)
+ATOMIC_DEFINE_RMW(clear_bits, u32, uint32_t, __LDREXW, __STREXW, old & ~value)
+ATOMIC_DEFINE_CAS(u32, uint32_t, __LDREXW, __STREXW)
+
+ATOMIC_DEFINE_RMW(fetch_add, u8, uint8_t, __LDREXB, __STREXB, old + value)
+ATOMIC_DEFINE_RMW(exchange, u8, uint8_t, __LDREXB, __STREXB, value)
+ATOMIC_DEFINE_RMW(set_bits, u8, uint8_t, __LDREXB, __STREXB, old | value)
+ATOMIC_DEFINE_RMW(clear_bits, u8, uint8_t, __LDREXB, __STREXB, old & ~value)
+ATOMIC_DEFINE_CAS(u8, uint8_t, __LDREXB, __STREXB)
+
+/*
+ * Pointer operations, built on the 32-bit ones on Cortex-M. The host
+ * port has 64-bit pointers and provides 64-bit exclusive accesses.
+ */
+
+#if UINTPTR_MAX == UINT32_MAX
+
+static inline void *atomic_exchange_ptr(void * volatile *ptr, void *value)
+{
+    return (void *)atomic_exchange_u32((volatile uint32_t *)ptr, (uint32_t)value);
+}
+
+static inline void *atomic_compare_exchange_ptr(void * volatile *ptr, void *expected, void *desired)
+{
+    return (void *)atomic_compare_exchange_u32((volatile uint32_t *)ptr,
+                                               (uint32_t)expected, (uint32_t)desired);
+}
+
+#else
+
+ATOMIC_DEFINE_RMW(exchange, u64, uint64_t, __LDREXD, __STREXD, value)
+ATOMIC_DEFINE_CAS(u64, uint64_t, __LDREXD, __STREXD)
+
+static inline void *atomic_exchange_ptr(void * volatile *ptr, void *value)
+{
+    return (void *)atomic_exchange_u64((volatile uint64_t *)ptr, (uint64_t)value);
+}
+
+static inline void *atomic_compare_exchange_ptr(void * volatile *ptr, void *expected, void *desired)
+{
+    return (void *)atomic_compare_exchange_u64((volatile uint64_t *)ptr,
+                                               (uint64_t)expected, (uint64_t)desired);
+}
+
+#endif
+
+#endif
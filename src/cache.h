@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+/*
+ * Helpers for drivers sharing buffers with a DMA controller when the
+ * data cache is enabled (Cortex-M7). On cores without data cache, the
+ * maintenance functions are no-ops.
+ *
+ * Note that DTCM is not cached: buffers tagged with DTCM_BSS do not need
+ * any maintenance.
+ */
+
+#define CACHE_LINE_SIZE     (32)
+
+#define CACHE_ALIGNED       __attribute__((aligned(CACHE_LINE_SIZE)))
+
+/* Round size up to a whole number of cache lines */
+#define CACHE_LINE_ROUND(size) \
+    (((size) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1))
+
+/*
+ * Declare a DMA buffer of at least size bytes. The buffer starts on a
+ * cache line and spans whole cache lines, so that invalidating it never
+ * discards data belonging to a neighbouring variable.
+ */
+#define DMA_BUFFER(name, size) \
+    uint8_t CACHE_ALIGNED name[CACHE_LINE_ROUND(size)]
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+
+static inline uint32_t cache_range_start(const void *addr)
+{
+    return (uint32_t)addr & ~(CACHE_LINE_SIZE - 1);
+}
+
+static inline int32_t cache_range_size(const void *addr, uint32_t size)
+{
+    return (int32_t)CACHE_LINE_ROUND((uint32_t)addr + size - cache_range_start(addr));
+}
+
+/**
+ * @brief Write back dirty cache lines to memory
+ *
+ * Call before the DMA controller reads the buffer (memory to peripheral).
+ *
+ * @param[in] addr
+ * @param[in] size
+ */
+static inline void cache_clean(const void *addr, uint32_t size)
+{
+    SCB_CleanDCache_by_Addr((uint32_t *)cache_range_start(addr), cache_range_size(addr, size));
+}
+
+/**
+ * @brief Discard cached copies of a buffer
+ *
+ * Call after the DMA controller wrote the buffer (peripheral to memory).
+ * The buffer must be declared with DMA_BUFFER.
+ *
+ * @param[in] addr
+ * @param[in] size
+ */
+static inline void cache_invalidate(void *addr, uint32_t size)
+{
+    SCB_InvalidateDCache_by_Addr((uint32_t *)cache_range_start(addr), cache_range_size(addr, size));
+}
+
+/**
+ * @brief Write back then discard cached copies of a buffer
+ *
+ * @param[in] addr
+ * @param[in] size
+ */
+static inline void cache_clean_invalidate(void *addr, uint32_t size)
+{
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t *)cache_range_start(addr), cache_range_size(addr, size));
+}
+
+#else
+
+static inline void cache_clean(const void *addr, uint32_t size)
+{
+    (void)addr;
+    (void)size;
+}
+
+static inline void cache_invalidate(void *addr, uint32_t size)
+{
+    (void)addr;
+    (void)size;
+}
+
+static inline void cache_clean_invalidate(void *addr, uint32_t size)
+{
+    (void)addr;
+    (void)size;
+}
+
+#endif
+
+#endif
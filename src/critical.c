@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "critical.h"
+
+#ifdef MASKED_TIME
+
+#include "semihosting.h"
+
+void critical_sites_print(void)
+{
+    struct critical_site_t *site;
+
+    semihosting_write("function,line,count,max,total\n");
+    for (site = _scritical_sites; site < _ecritical_sites; ++site) {
+        struct critical_site_t copy;
+        critical_state_t state;
+
+        if (!site->count)
+            continue;
+
+        /* Take a consistent snapshot, semihosting calls are slow */
+        state = critical_enter();
+        copy = *site;
+        critical_exit(state);
+
+        semihosting_write(copy.function);
+        semihosting_write(",");
+        semihosting_write_u32(copy.line);
+        semihosting_write(",");
+        semihosting_write_u32(copy.count);
+        semihosting_write(",");
+        semihosting_write_u32(copy.max);
+        semihosting_write(",");
+        semihosting_write_u64(copy.total);
+        semihosting_write("\n");
+    }
+}
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CRITICAL_H
+#define CRITICAL_H
+
+#include "scheduler.h"
+#include <stdint.h>
+
+/*
+ * Kernel critical sections mask interrupts through BASEPRI instead of
+ * PRIMASK: interrupts with a priority higher than SCHEDULER_IRQ_PRIORITY
+ * are never delayed by the kernel.
+ */
+
+#define CRITICAL_BASEPRI    (SCHEDULER_IRQ_PRIORITY << (8 - __NVIC_PRIO_BITS))
+
+_Static_assert(SCHEDULER_IRQ_PRIORITY > 0 && SCHEDULER_IRQ_PRIORITY < (1 << __NVIC_PRIO_BITS),
+               "SCHEDULER_IRQ_PRIORITY must be a valid non-zero NVIC priority");
+
+/* BASEPRI value as a string for assembly code */
+#define CRITICAL_STR(x)             #x
+#define CRITICAL_XSTR(x)            CRITICAL_STR(x)
+#define CRITICAL_BASEPRI_STR        CRITICAL_XSTR(CRITICAL_BASEPRI)
+
+#ifndef MASKED_TIME
+
+typedef uint32_t critical_state_t;
+
+/**
+ * @brief Enter kernel critical section
+ *
+ * Critical sections can be nested.
+ *
+ * @return State to pass to critical_exit
+ */
+static inline critical_state_t critical_enter(void)
+{
+    critical_state_t state = __get_BASEPRI();
+
+    __set_BASEPRI_MAX(CRITICAL_BASEPRI);
+
+    return state;
+}
+
+/**
+ * @brief Leave kernel critical section
+ *
+ * @param[in] state Value returned by matching critical_enter
+ */
+static inline void critical_exit(critical_state_t state)
+{
+    __set_BASEPRI(state);
+}
+
+#else
+
+/*
+ * When built with MASKED_TIME=1, each critical_enter call site records
+ * how long it masked interrupts, measured with the DWT cycle counter.
+ * Nested critical sections do not mask more interrupts, so only the
+ * outermost one is measured. Sites are collected in the .critical_sites
+ * section, from _scritical_sites to _ecritical_sites.
+ *
+ * pendsv_handler masks interrupts from assembly code, it is recorded as
+ * its own site. svcall_handler only runs once, before the first task,
+ * and is not measured.
+ */
+
+#include "cycles.h"
+#include <stddef.h>
+
+struct critical_site_t {
+    const char *function;
+    uint32_t line;
+    uint32_t count;     /* Number of times interrupts were masked */
+    uint32_t max;       /* Cycles */
+    uint64_t total;     /* Cycles */
+};
+
+extern struct critical_site_t _scritical_sites[];
+extern struct critical_site_t _ecritical_sites[];
+
+typedef struct {
+    uint32_t basepri;
+    uint32_t start;
+    struct critical_site_t *site;
+} critical_state_t;
+
+static inline critical_state_t critical_enter_site(struct critical_site_t *site)
+{
+    critical_state_t state;
+
+    state.basepri = __get_BASEPRI();
+    __set_BASEPRI_MAX(CRITICAL_BASEPRI);
+
+    state.site = NULL;
+    if (state.basepri == 0 || state.basepri > CRITICAL_BASEPRI) {
+        state.site = site;
+        state.start = cycles_read();
+    }
+
+    return state;
+}
+
+#define critical_enter()                                                    \
+    ({                                                                      \
+        static struct critical_site_t critical_site                         \
+        __attribute__((used, section(".critical_sites"))) = {               \
+            .function = __func__,                                           \
+            .line = __LINE__,                                               \
+        };                                                                  \
+        critical_enter_site(&critical_site);                                \
+    })
+
+/* Must be called with interrupts masked */
+static inline void critical_site_record(struct critical_site_t *site, uint32_t cycles)
+{
+    site->count++;
+    site->total += cycles;
+    if (cycles > site->max)
+        site->max = cycles;
+}
+
+static inline void critical_exit(critical_state_t state)
+{
+    if (state.site)
+        critical_site_record(state.site, cycles_read() - state.start);
+
+    __set_BASEPRI(state.basepri);
+}
+
+/**
+ * @brief Clear statistics of all critical_enter call sites
+ */
+static inline void critical_sites_reset(void)
+{
+    struct critical_site_t *site;
+    critical_state_t state;
+
+    state = critical_enter();
+    for (site = _scritical_sites; site < _ecritical_sites; ++site) {
+        site->count = 0;
+        site->max = 0;
+        site->total = 0;
+    }
+    critical_exit(state);
+}
+
+/**
+ * @brief Print statistics of all sites through semihosting
+ *
+ * Sites which never masked interrupts are skipped. Output is CSV:
+ * function, line, count, max and total cycles.
+ */
+void critical_sites_print(void);
+
+#endif
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include <stdint.h>
+
+/*
+ * Cycle counter of the DWT unit, used by the kernel instrumentation
+ * and benchmarks. It wraps around every 2^32 cycles, so only differences
+ * between two reads are meaningful.
+ *
+ * QEMU does not emulate the DWT: on QEMU boards, CYCLES_CMSDK_TIMER
+ * selects the free-running CMSDK timer 0 instead, which counts at the
+ * peripheral clock. The host port counts nanoseconds.
+ */
+
+#if defined(BOARD_HOST)
+
+#include <time.h>
+
+static inline void cycles_init(void)
+{
+}
+
+static inline uint32_t cycles_read(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)now.tv_sec * 1000000000U + (uint32_t)now.tv_nsec;
+}
+
+#elif !defined(CYCLES_CMSDK_TIMER)
+
+static inline void cycles_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#ifdef __CM7_REV
+    /* DWT registers are locked on Cortex-M7 */
+    DWT->LAR = 0xC5ACCE55;
+#endif
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t cycles_read(void)
+{
+    return DWT->CYCCNT;
+}
+
+#else
+
+static inline void cycles_init(void)
+{
+    CMSDK_TIMER0->CTRL = 0;
+    CMSDK_TIMER0->RELOAD = UINT32_MAX;
+    CMSDK_TIMER0->VALUE = UINT32_MAX;
+    CMSDK_TIMER0->CTRL = CMSDK_TIMER_CTRL_EN_Msk;
+}
+
+static inline uint32_t cycles_read(void)
+{
+    /* The timer counts down */
+    return ~CMSDK_TIMER0->VALUE;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "irq.h"
+#include "section.h"
+#include <string.h>
+
+#define CORE_VECTOR_COUNT       (16)
+#define VECTOR_COUNT            (CORE_VECTOR_COUNT + VENDOR_IRQ_COUNT)
+
+/* VTOR requires the table to be aligned on its size rounded up to a power of two */
+#define VECTOR_TABLE_ALIGN      (512)
+
+_Static_assert(VECTOR_COUNT * sizeof(void *) <= VECTOR_TABLE_ALIGN, "VECTOR_TABLE_ALIGN is too small");
+
+extern void * const core_vector_table[CORE_VECTOR_COUNT];
+extern void * const vendor_vector_table[VENDOR_IRQ_COUNT];
+
+static DTCM_BSS void *ram_vector_table[VECTOR_COUNT] __attribute__((aligned(VECTOR_TABLE_ALIGN)));
+
+void irq_init(void)
+{
+    memcpy(ram_vector_table, core_vector_table, sizeof(core_vector_table));
+    memcpy(&ram_vector_table[CORE_VECTOR_COUNT], vendor_vector_table, sizeof(vendor_vector_table));
+
+    __DSB();
+    SCB->VTOR = (uint32_t)ram_vector_table;
+    __DSB();
+    __ISB();
+}
+
+void irq_register(IRQn_Type irq, void (*handler)(void))
+{
+    ram_vector_table[CORE_VECTOR_COUNT + irq] = handler;
+    __DSB();
+}
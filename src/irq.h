@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+/*
+ * The vector table is copied to RAM at boot, so that handlers can be
+ * registered at runtime and are called directly by the hardware.
+ */
+
+/**
+ * @brief Copy vector table to RAM and make it active
+ *
+ * Called by reset_handler.
+ */
+void irq_init(void);
+
+/**
+ * @brief Register interrupt handler
+ *
+ * irq can also be a core exception such as SysTick_IRQn, except for
+ * SVCall_IRQn and PendSV_IRQn which are used by the scheduler.
+ *
+ * @param[in] irq
+ * @param[in] handler
+ */
+void irq_register(IRQn_Type irq, void (*handler)(void));
+
+#endif
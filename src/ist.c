@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "irq.h"
+#include "ist.h"
+#include "scheduler.h"
+#include "trace.h"
+#include <stdint.h>
+
+/* Task bound to each interrupt */
+static uint8_t ist_tasks[VENDOR_IRQ_COUNT];
+
+_Static_assert(TASK_COUNT <= UINT8_MAX, "ist_tasks cannot hold task IDs");
+
+static void ist_handler(void)
+{
+    IRQn_Type irq = (IRQn_Type)(__get_IPSR() - 16);
+
+    TRACE_ISR_ENTER();
+    NVIC_DisableIRQ(irq);
+    task_wake(ist_tasks[irq]);
+    TRACE_ISR_EXIT();
+}
+
+int ist_bind(IRQn_Type irq, unsigned int task_id)
+{
+    /* Core exceptions cannot be masked in the NVIC */
+    if (irq < 0 || irq >= VENDOR_IRQ_COUNT)
+        return -1;
+
+    ist_tasks[irq] = task_id;
+    irq_register(irq, ist_handler);
+
+    return 0;
+}
+
+void ist_wait(IRQn_Type irq)
+{
+    /*
+     * If the interrupt fires before the task yields, the task is already
+     * scheduled again when it yields.
+     *
+     * The task has just serviced the device: a level-triggered line was
+     * still asserted when ist_handler masked it, so the pending bit is
+     * stale and would cause a spurious wakeup.
+     */
+    NVIC_ClearPendingIRQ(irq);
+    NVIC_EnableIRQ(irq);
+    scheduler_yield();
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IST_H
+#define IST_H
+
+/*
+ * Interrupt service threads: a peripheral interrupt is bound to a task.
+ * The hardware handler only masks the interrupt in the NVIC and wakes up
+ * the task, which does the processing and unmasks the interrupt when it
+ * waits for the next one. Interrupt processing is then preemptible and
+ * ordered by task priority.
+ *
+ * An interrupt service thread looks like:
+ *
+ *     static void uart_ist(void)
+ *     {
+ *         while (1) {
+ *             ist_wait(USART2_IRQn);
+ *             ... process and clear interrupt flags ...
+ *         }
+ *     }
+ */
+
+/**
+ * @brief Bind interrupt to task
+ *
+ * The interrupt is enabled by the first call to ist_wait.
+ *
+ * @param[in] irq Peripheral interrupt, core exceptions are rejected
+ * @param[in] task_id
+ * @return 0 if successful, -1 if irq is not a peripheral interrupt
+ */
+int ist_bind(IRQn_Type irq, unsigned int task_id);
+
+/**
+ * @brief Unmask interrupt and yield until it fires
+ *
+ * Must be called by the task bound to irq, once it has serviced the
+ * device: the pending state of the interrupt is cleared before it is
+ * unmasked.
+ *
+ * @param[in] irq
+ */
+void ist_wait(IRQn_Type irq);
+
+#endif
@@ -18,12 +18,9 @@
  */
 
 #include "scheduler.h"
-#include <stdint.h>
 
 #define DUMMY_TASK_ID       (1)
 
-static uint8_t dummy_task_stack[1024];
-
 void dummy_task(void)
 {
     while (1) {
@@ -35,11 +32,10 @@ void dummy_task(void)
     }
 }
 
+TASK_DEFINE(dummy_task, DUMMY_TASK_ID, dummy_task, 1024, 0, TASK_SCHEDULED);
+
 void main(void)
 {
-    task_create(DUMMY_TASK_ID, dummy_task, dummy_task_stack, 1024);
-    task_schedule(DUMMY_TASK_ID);
-
     while (1) {
 
         /*
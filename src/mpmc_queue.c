@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "atomic.h"
+#include "mpmc_queue.h"
+#include "scheduler.h"
+
+_Static_assert(TASK_COUNT <= 32, "waiting_tasks cannot hold more than 32 tasks");
+
+void mpmc_queue_init(struct mpmc_queue_t *queue, struct mpmc_cell_t *cells, uint32_t length)
+{
+    uint32_t i;
+
+    for (i = 0; i < length; ++i)
+        cells[i].sequence = i;
+
+    queue->cells = cells;
+    queue->mask = length - 1;
+    queue->enqueue_pos = 0;
+    queue->dequeue_pos = 0;
+    queue->waiting_tasks = 0;
+}
+
+int mpmc_queue_push(struct mpmc_queue_t *queue, void *data)
+{
+    struct mpmc_cell_t *cell;
+    uint32_t pos, waiting;
+
+    pos = queue->enqueue_pos;
+    while (1) {
+        int32_t diff;
+
+        cell = &queue->cells[pos & queue->mask];
+        diff = (int32_t)(cell->sequence - pos);
+        if (diff == 0) {
+            uint32_t old = atomic_compare_exchange_u32(&queue->enqueue_pos, pos, pos + 1);
+
+            if (old == pos)
+                break;
+            pos = old;
+        } else if (diff < 0) {
+            /* Cell still holds data from the previous lap */
+            return -1;
+        } else {
+            /* Another producer claimed this cell */
+            pos = queue->enqueue_pos;
+        }
+    }
+
+    cell->data = data;
+    __DMB();
+    cell->sequence = pos + 1;
+
+    waiting = atomic_exchange_u32(&queue->waiting_tasks, 0);
+    while (waiting) {
+        unsigned int id = 31 - __CLZ(waiting);
+
+        waiting &= ~(1U << id);
+        task_wake(id);
+    }
+
+    return 0;
+}
+
+int mpmc_queue_pop(struct mpmc_queue_t *queue, void **data)
+{
+    struct mpmc_cell_t *cell;
+    uint32_t pos;
+
+    pos = queue->dequeue_pos;
+    while (1) {
+        int32_t diff;
+
+        cell = &queue->cells[pos & queue->mask];
+        diff = (int32_t)(cell->sequence - (pos + 1));
+        if (diff == 0) {
+            uint32_t old = atomic_compare_exchange_u32(&queue->dequeue_pos, pos, pos + 1);
+
+            if (old == pos)
+                break;
+            pos = old;
+        } else if (diff < 0) {
+            /* Cell not filled yet */
+            return -1;
+        } else {
+            /* Another consumer emptied this cell */
+            pos = queue->dequeue_pos;
+        }
+    }
+
+    *data = cell->data;
+    __DMB();
+    cell->sequence = pos + queue->mask + 1;
+
+    return 0;
+}
+
+void *mpmc_queue_pop_wait(struct mpmc_queue_t *queue)
+{
+    uint32_t mask = 1U << task_get_current();
+    void *data;
+
+    while (mpmc_queue_pop(queue, &data)) {
+        atomic_set_bits_u32(&queue->waiting_tasks, mask);
+
+        /* Data may have been pushed before this task was registered */
+        if (!mpmc_queue_pop(queue, &data)) {
+            atomic_clear_bits_u32(&queue->waiting_tasks, mask);
+            break;
+        }
+
+        scheduler_yield();
+    }
+
+    return data;
+}
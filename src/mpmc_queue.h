@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stdint.h>
+
+/*
+ * Bounded multi-producer multi-consumer queue of pointers. Each cell has
+ * a sequence number telling whether it is free or full for a given
+ * position, so that producers and consumers only need one compare and
+ * exchange to claim a cell. Interrupts are never masked: the queue can
+ * be used from tasks and from nested interrupt handlers at any priority.
+ *
+ * A producer preempted between claiming a cell and filling it does not
+ * block anybody: until it resumes, consumers see the queue as empty.
+ */
+
+struct mpmc_cell_t {
+    volatile uint32_t sequence;
+    void *data;
+};
+
+struct mpmc_queue_t {
+    struct mpmc_cell_t *cells;
+    uint32_t mask;
+    volatile uint32_t enqueue_pos;
+    volatile uint32_t dequeue_pos;
+    volatile uint32_t waiting_tasks;    /* Bit n set if task n waits for data */
+};
+
+/**
+ * @brief Initialize queue
+ *
+ * @param[out] queue
+ * @param[in] cells
+ * @param[in] length Number of cells, must be a power of two
+ */
+void mpmc_queue_init(struct mpmc_queue_t *queue, struct mpmc_cell_t *cells, uint32_t length);
+
+/**
+ * @brief Push data to queue
+ *
+ * Tasks waiting in mpmc_queue_pop_wait are woken up.
+ *
+ * @param[in] queue
+ * @param[in] data
+ * @return 0 if successful, -1 if the queue is full
+ */
+int mpmc_queue_push(struct mpmc_queue_t *queue, void *data);
+
+/**
+ * @brief Pop data from queue
+ *
+ * @param[in] queue
+ * @param[out] data
+ * @return 0 if successful, -1 if the queue is empty
+ */
+int mpmc_queue_pop(struct mpmc_queue_t *queue, void **data);
+
+/**
+ * @brief Pop data from queue, yield until data is available
+ *
+ * Must only be called from a task.
+ *
+ * @param[in] queue
+ * @return data
+ */
+void *mpmc_queue_pop_wait(struct mpmc_queue_t *queue);
+
+#endif
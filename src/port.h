@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PORT_H
+#define PORT_H
+
+/*
+ * Interface between the scheduler, which implements the scheduling
+ * policy, and the port, which switches contexts on a given architecture:
+ * port_cortex_m.c on Cortex-M boards, port_host.c on the host.
+ */
+
+#include "scheduler.h"
+#include "section.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdnoreturn.h>
+
+/* FPU flags */
+#define TASK_NO_FPU         (1U << 0)   /* FPU instructions trap */
+#define TASK_FPU_CONTEXT    (1U << 1)   /* s16-s31 are saved in fpu_context */
+
+struct task_t {
+    uint32_t stack_pointer;
+#ifdef __FPU_PRESENT
+    uint32_t exception_code;
+    uint32_t fpu_flags;
+    uint32_t fpu_context[16];
+#endif
+    enum task_status_t status;
+    unsigned int priority;
+    struct task_t *next;
+    struct task_t *pending_next;
+    volatile uint32_t wake_pending;
+#ifdef CPU_USAGE
+    uint64_t runtime;
+#endif
+#ifdef SWITCH_LATENCY
+    uint32_t yielded;   /* Task is switched out in scheduler_yield */
+#endif
+};
+
+/* Offsets are hardcoded in pendsv_handler and svcall_handler */
+_Static_assert(offsetof(struct task_t, stack_pointer) == 0, "stack_pointer must be at offset 0");
+#ifdef __FPU_PRESENT
+_Static_assert(offsetof(struct task_t, exception_code) == 4, "exception_code must be at offset 4");
+_Static_assert(offsetof(struct task_t, fpu_flags) == 8, "fpu_flags must be at offset 8");
+_Static_assert(offsetof(struct task_t, fpu_context) == 12, "fpu_context must be at offset 12");
+#endif
+
+extern struct task_t tasks[TASK_COUNT];
+extern struct task_t *current_task;
+extern struct task_t *next_task;
+
+/**
+ * @brief Select the task to switch to
+ *
+ * Called by the port when a switch was triggered, in a kernel critical
+ * section. The port then switches to the selected task, sets
+ * current_task to it and clears next_task.
+ *
+ * @return Task to switch to, or NULL to keep running current_task
+ */
+KERNEL_RAMFUNC struct task_t *scheduler_select(void);
+
+/**
+ * @brief Initialize the port, before tasks are created
+ */
+void port_init(void);
+
+/**
+ * @brief Switch to current_task for the first time
+ */
+noreturn void port_start(void);
+
+/**
+ * @brief Initialize the context of a task
+ *
+ * The task starts at entrypoint when first switched to, and yields for
+ * good if entrypoint returns.
+ *
+ * @param[in] id
+ * @param[in] entrypoint
+ * @param[in] stack
+ * @param[in] stack_size
+ */
+void port_task_init(unsigned int id, void (*entrypoint)(void), void *stack, uint32_t stack_size);
+
+/*
+ * The port header also provides these inline functions:
+ *
+ * port_irq_disable(), port_irq_enable(): mask all interrupts, including
+ *     those above SCHEDULER_IRQ_PRIORITY
+ * port_wait_for_interrupt(): sleep until an interrupt is pending, even
+ *     if interrupts are masked by port_irq_disable
+ * port_trigger_switch(): call scheduler_select and switch to the task it
+ *     returns, as soon as no kernel critical section is active
+ * port_task_resumed(): called by a task resuming in scheduler_yield
+ */
+#ifdef BOARD_HOST
+#include "port_host.h"
+#else
+#include "port_cortex_m.h"
+#endif
+
+#endif
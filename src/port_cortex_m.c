@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "critical.h"
+#include "cycles.h"
+#include "port.h"
+#include <stdint.h>
+#include <stdnoreturn.h>
+
+#define THUMB_STATE     (1U << 24)
+
+#define EXC_RETURN      (0xFFFFFFFD)
+
+/* NOCP bit of the UsageFault status register */
+#define CFSR_NOCP           (1U << 19)
+
+#ifdef __FPU_PRESENT
+/* ID of the integer-only task which used the FPU, read it with a debugger */
+static __attribute__((used)) volatile int fpu_fault_task = -1;
+#endif
+
+#ifdef MASKED_TIME
+/* pendsv_handler masks interrupts from assembly code */
+static struct critical_site_t pendsv_critical_site
+__attribute__((used, section(".critical_sites"))) = {
+    .function = "pendsv_handler",
+    .line = __LINE__,
+};
+
+static uint32_t pendsv_masked_start;
+
+static KERNEL_RAMFUNC __attribute__((used)) void pendsv_masked_begin(void)
+{
+    pendsv_masked_start = cycles_read();
+}
+
+static KERNEL_RAMFUNC __attribute__((used)) void pendsv_masked_end(void)
+{
+    critical_site_record(&pendsv_critical_site, cycles_read() - pendsv_masked_start);
+}
+#endif
+
+void KERNEL_RAMFUNC __attribute__((naked)) svcall_handler(void)
+{
+    __asm__ volatile(
+        ".thumb_func\n"
+
+        "mov r0, #" CRITICAL_BASEPRI_STR "\n"
+        "msr basepri, r0\n"
+
+        /* Read stack pointer of current_task */
+        "ldr r1, =current_task\n"
+        "ldr r1, [r1]\n"
+        "ldr r0, [r1]\n"
+
+        /* Load context of current_task */
+        "ldmfd r0!, {r4-r11}\n"
+        "msr psp, r0\n"
+
+#ifdef __FPU_PRESENT
+        "ldr lr, [r1, #4]\n"
+#else
+        "mov lr, 0xFFFFFFFD\n"
+#endif
+
+        "mov r0, #0\n"
+        "msr basepri, r0\n"
+        "bx lr\n"
+    );
+}
+
+void KERNEL_RAMFUNC __attribute__((naked)) pendsv_handler(void)
+{
+    __asm__ volatile(
+        ".thumb_func\n"
+
+        "mov r0, #" CRITICAL_BASEPRI_STR "\n"
+        "msr basepri, r0\n"
+
+#ifdef MASKED_TIME
+        "push {r0, lr}\n"
+        "bl pendsv_masked_begin\n"
+        "pop {r0, lr}\n"
+#endif
+
+        /* Select next_task, possibly woken up by an interrupt handler */
+        "push {r0, lr}\n"
+        "bl scheduler_select\n"
+        "mov r3, r0\n"
+        "pop {r0, lr}\n"
+
+        /* Load current_task and next_task */
+        "ldr r0, =current_task\n"
+        "ldr r2, =next_task\n"
+        "ldr r1, [r0]\n"
+
+        /* Nothing to do if there is no task to switch to */
+        "cmp r3, #0\n"
+        "beq context_switch_end\n"
+
+#ifdef __FPU_PRESENT
+        /*
+         * Save s16-s31 only if current_task used the FPU since it was
+         * switched in. Otherwise, fpu_context is still up to date.
+         *
+         * This is also needed when current_task was selected again: it
+         * resumes in scheduler_yield, which clears FPCA, so the next
+         * switch would not save s16-s31 either.
+         */
+        "tst lr, #0x00000010\n"
+        "bne fpu_save_end\n"
+        "add r12, r1, #12\n"
+        "vstmia r12, {s16-s31}\n"
+        "ldr r12, [r1, #8]\n"
+        "orr r12, r12, #2\n"   /* TASK_FPU_CONTEXT */
+        "str r12, [r1, #8]\n"
+        "fpu_save_end:\n"
+#endif
+
+        "cmp r1, r3\n"
+        "beq context_switch_end\n"
+
+        /* Save context of current_task */
+        "mrs r12, psp\n"
+        "stmfd r12!, {r4-r11}\n"
+        "str r12, [r1]\n"
+
+#ifdef __FPU_PRESENT
+        "str lr, [r1, #4]\n"   /* Save exception code */
+
+        /* Grant or deny FPU access to next_task, r4-r11 are free */
+        "ldr r12, [r3, #8]\n"
+        "ldr r1, =0xE000ED88\n"    /* CPACR */
+        "ldr r4, [r1]\n"
+        "bic r5, r4, #0x00F00000\n"
+        "tst r12, #1\n"        /* TASK_NO_FPU */
+        "it eq\n"
+        "orreq r5, r5, #0x00F00000\n"
+        "cmp r4, r5\n"
+        "beq fpu_access_end\n"
+        "str r5, [r1]\n"
+        "dsb\n"
+        "isb\n"
+        "fpu_access_end:\n"
+
+        /* Restore s16-s31 if next_task ever used the FPU */
+        "tst r12, #2\n"        /* TASK_FPU_CONTEXT */
+        "itt ne\n"
+        "addne r1, r3, #12\n"
+        "vldmiane r1, {s16-s31}\n"
+        "ldr lr, [r3, #4]\n"    /* Load exception code */
+#endif
+
+        /* Load context of next_task */
+        "ldr r1, [r3]\n"
+        "ldmfd r1!, {r4-r11}\n"
+        "msr psp, r1\n"
+
+        /* Set current_task to next_task */
+        "str r3, [r0]\n"
+
+        "context_switch_end:\n"
+
+        /* Set next_task to NULL */
+        "mov r1, #0\n"
+        "str r1, [r2]\n"
+
+#ifdef MASKED_TIME
+        /* r4-r11 hold the context of the task to return to */
+        "push {r0, lr}\n"
+        "bl pendsv_masked_end\n"
+        "pop {r0, lr}\n"
+        "mov r1, #0\n"
+#endif
+
+        "msr basepri, r1\n"
+        "bx lr\n"
+    );
+}
+
+/* Force GCC not to generate code for the stack */
+static noreturn void stop_task(void)
+{
+    /*
+     * We reach this function if the task returns from the entry point.
+     * In other words, the task finished its job.
+     */
+    scheduler_yield();
+    __builtin_unreachable();
+}
+
+#ifdef __FPU_PRESENT
+void usagefault_handler(void)
+{
+    if (SCB->CFSR & CFSR_NOCP)
+        fpu_fault_task = current_task - tasks;
+
+    __asm__ volatile ("cpsid i" ::: "memory");
+    while (1);
+}
+#endif
+
+void port_init(void)
+{
+    NVIC_SetPriority(PendSV_IRQn, 255);
+#ifdef __FPU_PRESENT
+    /* Report FPU usage by integer-only tasks with a UsageFault */
+    SCB->SHCSR |= SCB_SHCSR_USGFAULTENA_Msk;
+#endif
+}
+
+noreturn void port_start(void)
+{
+    /* svcall_handler loads the context of current_task */
+    __asm__ volatile ("cpsie i" : : : "memory");
+    __asm__ volatile ("svc 0");
+
+    __builtin_unreachable();
+}
+
+void port_task_init(unsigned int id, void (*entrypoint)(void), void *stack, uint32_t stack_size)
+{
+    uint32_t *sp;
+
+    sp = (uint32_t *)((uint32_t)stack + stack_size);
+
+    /*
+     * xPSR, PC, LR, R12, R3, R2, R1, R0 are restored by the
+     * hardware upon leaving exception mode.
+     */
+    *--sp = ((uint32_t)entrypoint & 0x1) ? THUMB_STATE : 0;
+    *--sp = (uint32_t)entrypoint;
+    *--sp = (uint32_t)stop_task;
+    *--sp = 12;
+    *--sp = 3;
+    *--sp = 2;
+    *--sp = 1;
+    *--sp = 0;
+
+    /* R4-R11 need to be manually restored */
+    *--sp = 11;
+    *--sp = 10;
+    *--sp = 9;
+    *--sp = 8;
+    *--sp = 7;
+    *--sp = 6;
+    *--sp = 5;
+    *--sp = 4;
+
+    tasks[id].stack_pointer = (uint32_t)sp;
+#ifdef __FPU_PRESENT
+    tasks[id].exception_code = EXC_RETURN;
+    tasks[id].fpu_flags = 0;
+#endif
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PORT_CORTEX_M_H
+#define PORT_CORTEX_M_H
+
+static inline void port_irq_disable(void)
+{
+    __asm__ volatile ("cpsid i" ::: "memory");
+}
+
+static inline void port_irq_enable(void)
+{
+    __asm__ volatile ("cpsie i" ::: "memory");
+}
+
+static inline void port_wait_for_interrupt(void)
+{
+    __asm__ volatile ("wfi" ::: "memory");
+}
+
+static inline void port_trigger_switch(void)
+{
+    /* pendsv_handler runs once no interrupt handler is active */
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+static inline void port_task_resumed(void)
+{
+#ifdef __FPU_PRESENT
+    /*
+     * The task is running again. pendsv_handler saved s16-s31 to
+     * fpu_context, even if it selected the same task again, and s0-s15
+     * do not survive a function call, so clear FPCA: the next switch only
+     * saves FPU registers if the task uses the FPU again.
+     */
+    __set_CONTROL(__get_CONTROL() & ~CONTROL_FPCA_Msk);
+    __ISB();
+#endif
+}
+
+#endif
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host port: tasks are ucontext contexts of a single process thread.
+ *
+ * Simulated interrupts are raised with signals. The signal handler runs
+ * the interrupt handlers, unless interrupts are masked by a kernel
+ * critical section or by port_irq_disable. In that case, they stay
+ * pending and run when interrupts are unmasked, like on Cortex-M.
+ * Pending context switches are handled after interrupt handlers, as
+ * PendSV would be, possibly by switching contexts from the signal
+ * handler.
+ *
+ * Task stacks passed to task_create are too small for the C library and
+ * for signal frames, so each task runs on a HOST_STACK_SIZE stack.
+ */
+
+#include "critical.h"
+#include "port.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+/* The process entry point, task_main is the main task */
+#undef main
+
+#define HOST_STACK_SIZE     (256 * 1024)
+
+volatile uint32_t host_basepri;
+volatile uint32_t host_primask = 1;
+volatile uint32_t host_ipsr;
+volatile uint32_t host_pending;
+volatile uint32_t host_pendsv;
+volatile uint32_t host_exclusive;
+volatile uint64_t host_exclusive_value;
+
+static void (*host_handlers[HOST_IRQ_COUNT])(void);
+static unsigned int host_timer_irq;
+
+static sigset_t host_signals;
+
+static ucontext_t contexts[TASK_COUNT];
+static void (*entrypoints[TASK_COUNT])(void);
+static uint8_t __attribute__((aligned(16))) stacks[TASK_COUNT][HOST_STACK_SIZE];
+
+/*
+ * Run pending interrupt handlers and context switch while interrupts
+ * are unmasked. Signals must be blocked.
+ */
+static void host_dispatch(void)
+{
+    while (!host_basepri && !host_primask) {
+        uint32_t pending = __atomic_exchange_n(&host_pending, 0, __ATOMIC_SEQ_CST);
+
+        /* Taking an exception clears the exclusive monitor */
+        host_exclusive = 0;
+
+        if (pending) {
+            while (pending) {
+                unsigned int irq = __builtin_ctz(pending);
+
+                pending &= ~(1U << irq);
+                host_ipsr = 16 + irq;
+                if (host_handlers[irq])
+                    host_handlers[irq]();
+            }
+            host_ipsr = 0;
+        } else if (host_pendsv) {
+            struct task_t *prev = current_task;
+            struct task_t *next;
+
+            host_pendsv = 0;
+            host_basepri = CRITICAL_BASEPRI;
+
+            next = scheduler_select();
+            next_task = NULL;
+            if (next && next != prev) {
+                current_task = next;
+                host_basepri = 0;
+                swapcontext(&contexts[prev - tasks], &contexts[next - tasks]);
+            }
+
+            /* Back in prev, which was switched out with interrupts unmasked */
+            host_basepri = 0;
+        } else {
+            break;
+        }
+    }
+}
+
+static void host_signal_handler(int signal)
+{
+    if (signal == SIGALRM)
+        __atomic_fetch_or(&host_pending, 1U << host_timer_irq, __ATOMIC_SEQ_CST);
+
+    if (!host_ipsr)
+        host_dispatch();
+}
+
+void host_unmasked(void)
+{
+    sigset_t mask;
+
+    sigprocmask(SIG_BLOCK, &host_signals, &mask);
+    host_dispatch();
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+}
+
+void host_irq_register(unsigned int irq, void (*handler)(void))
+{
+    host_handlers[irq] = handler;
+}
+
+void host_irq_raise(unsigned int irq)
+{
+    __atomic_fetch_or(&host_pending, 1U << irq, __ATOMIC_SEQ_CST);
+    kill(getpid(), SIGUSR1);
+}
+
+void host_timer_start(unsigned int irq, uint32_t period_us)
+{
+    struct itimerval timer = {
+        .it_interval = { .tv_sec = period_us / 1000000, .tv_usec = period_us % 1000000 },
+        .it_value = { .tv_sec = period_us / 1000000, .tv_usec = period_us % 1000000 },
+    };
+
+    host_timer_irq = irq;
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+void port_wait_for_interrupt(void)
+{
+    sigset_t mask;
+
+    /* Signals only mark interrupts pending while PRIMASK is set */
+    sigprocmask(SIG_BLOCK, &host_signals, &mask);
+    while (!host_pending)
+        sigsuspend(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+}
+
+static void host_task_entry(void)
+{
+    entrypoints[current_task - tasks]();
+
+    /* The task finished its job */
+    while (1)
+        scheduler_yield();
+}
+
+void port_init(void)
+{
+    struct sigaction action = {
+        .sa_handler = host_signal_handler,
+    };
+
+    sigemptyset(&host_signals);
+    sigaddset(&host_signals, SIGUSR1);
+    sigaddset(&host_signals, SIGALRM);
+
+    /* Interrupt handlers do not nest */
+    action.sa_mask = host_signals;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+    sigaction(SIGALRM, &action, NULL);
+}
+
+noreturn void port_start(void)
+{
+    /* Interrupts are masked until the main task starts, as on Cortex-M */
+    host_primask = 0;
+    setcontext(&contexts[current_task - tasks]);
+    abort();
+}
+
+void port_task_init(unsigned int id, void (*entrypoint)(void), void *stack, uint32_t stack_size)
+{
+    ucontext_t *context = &contexts[id];
+
+    (void)stack;
+    (void)stack_size;
+
+    getcontext(context);
+    context->uc_stack.ss_sp = stacks[id];
+    context->uc_stack.ss_size = HOST_STACK_SIZE;
+    context->uc_link = NULL;
+    sigemptyset(&context->uc_sigmask);
+    makecontext(context, host_task_entry, 0);
+
+    entrypoints[id] = entrypoint;
+}
+
+int main(void)
+{
+    scheduler_start();
+
+    return 0;
+}
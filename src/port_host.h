@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PORT_HOST_H
+#define PORT_HOST_H
+
+static inline void port_irq_disable(void)
+{
+    host_primask = 1;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void port_irq_enable(void)
+{
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    host_primask = 0;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    host_check_pending();
+}
+
+void port_wait_for_interrupt(void);
+
+static inline void port_trigger_switch(void)
+{
+    /* Switch now, or once interrupts are unmasked or handlers return */
+    host_pendsv = 1;
+    host_check_pending();
+}
+
+static inline void port_task_resumed(void)
+{
+}
+
+#endif
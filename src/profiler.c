@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "irq.h"
+#include "port.h"
+#include "profiler.h"
+#include <stdint.h>
+
+/* Entries tried before a sample is dropped */
+#define PROFILER_PROBES         (8)
+
+/* EXC_RETURN bits */
+#define EXC_RETURN_THREAD       (1U << 3)
+#define EXC_RETURN_PSP          (1U << 2)
+
+struct profiler_buffer_t profiler_buffer;
+
+/*
+ * Count a sample. The stack frame holds r0-r3, r12, LR, PC and xPSR of
+ * the interrupted context.
+ */
+static __attribute__((used)) void profiler_sample(uint32_t exc_return, const uint32_t *frame)
+{
+    uint32_t pc = frame[6];
+    uint32_t lr = frame[5];
+    uint32_t task = PROFILER_HANDLER;
+    uint32_t hash;
+    unsigned int i;
+
+    if ((exc_return & EXC_RETURN_THREAD) && (exc_return & EXC_RETURN_PSP))
+        task = current_task - tasks;
+
+    profiler_buffer.samples++;
+
+    hash = ((pc >> 1) ^ (lr << 7) ^ task) * 2654435761U;
+    for (i = 0; i < PROFILER_PROBES; ++i) {
+        struct profiler_entry_t *entry;
+
+        entry = &profiler_buffer.entries[(hash + i) & (PROFILER_LENGTH - 1)];
+        if (!entry->count) {
+            entry->pc = pc;
+            entry->lr = lr;
+            entry->task = task;
+            entry->count = 1;
+            return;
+        }
+
+        if (entry->pc == pc && entry->lr == lr && entry->task == task) {
+            entry->count++;
+            return;
+        }
+    }
+
+    profiler_buffer.dropped++;
+}
+
+static void __attribute__((naked)) profiler_handler(void)
+{
+    __asm__ volatile(
+        ".thumb_func\n"
+
+        /* Find the stack frame, profiler_sample returns from the exception */
+        "mov r0, lr\n"
+        "tst lr, #4\n"
+        "ite eq\n"
+        "mrseq r1, msp\n"
+        "mrsne r1, psp\n"
+        "b profiler_sample\n"
+    );
+}
+
+int profiler_start(uint32_t frequency)
+{
+    unsigned int i;
+
+    SysTick->CTRL = 0;
+
+    for (i = 0; i < PROFILER_LENGTH; ++i)
+        profiler_buffer.entries[i].count = 0;
+    profiler_buffer.samples = 0;
+    profiler_buffer.dropped = 0;
+    profiler_buffer.frequency = frequency;
+    profiler_buffer.magic = PROFILER_MAGIC;
+
+    if (!frequency)
+        return -1;
+
+    irq_register(SysTick_IRQn, profiler_handler);
+    if (SysTick_Config(CORE_CLOCK / frequency))
+        return -1;
+    NVIC_SetPriority(SysTick_IRQn, PROFILER_IRQ_PRIORITY);
+
+    return 0;
+}
+
+void profiler_stop(void)
+{
+    SysTick->CTRL = 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+
+/*
+ * Statistical profiler. SysTick interrupts the running code at a fixed
+ * frequency, and the PC and LR of the interrupted context are counted,
+ * with the running task, in a hash table in RAM, profiler_buffer.
+ * tools/profile.py symbolizes a dump of it.
+ *
+ * SysTick runs above SCHEDULER_IRQ_PRIORITY, so kernel critical sections
+ * are sampled too. Its handler only reads current_task. SysTick cannot
+ * be used by the application while the profiler runs.
+ */
+
+#ifndef PROFILER_LENGTH
+#define PROFILER_LENGTH         (512)
+#endif
+
+_Static_assert((PROFILER_LENGTH & (PROFILER_LENGTH - 1)) == 0, "PROFILER_LENGTH must be a power of two");
+
+#ifndef PROFILER_IRQ_PRIORITY
+#define PROFILER_IRQ_PRIORITY   (SCHEDULER_IRQ_PRIORITY - 1)
+#endif
+
+_Static_assert(PROFILER_IRQ_PRIORITY >= 0 && PROFILER_IRQ_PRIORITY < SCHEDULER_IRQ_PRIORITY,
+               "PROFILER_IRQ_PRIORITY must be a valid NVIC priority above SCHEDULER_IRQ_PRIORITY");
+
+#define PROFILER_MAGIC          (0x50524F46)
+
+/* Task of samples taken in interrupt handlers */
+#define PROFILER_HANDLER        (0xFF)
+
+/*
+ * LR is the return address of the sampled function only if it was
+ * interrupted before calling another function.
+ */
+struct profiler_entry_t {
+    uint32_t pc;
+    uint32_t lr;
+    uint32_t task;
+    uint32_t count;         /* 0 if the entry is free */
+};
+
+struct profiler_buffer_t {
+    uint32_t magic;
+    uint32_t frequency;     /* Samples per second */
+    volatile uint32_t samples;
+    volatile uint32_t dropped;  /* Samples which did not fit in entries */
+    struct profiler_entry_t entries[PROFILER_LENGTH];
+};
+
+extern struct profiler_buffer_t profiler_buffer;
+
+/**
+ * @brief Clear profiler_buffer and start sampling
+ *
+ * The overhead is proportional to the frequency: each sample costs
+ * a SysTick interrupt and a lookup in the hash table.
+ *
+ * @param[in] frequency Samples per second
+ * @return 0 if successful, -1 if SysTick cannot run at this frequency
+ */
+int profiler_start(uint32_t frequency);
+
+/**
+ * @brief Stop sampling
+ *
+ * profiler_buffer is kept until profiler_start is called again.
+ */
+void profiler_stop(void);
+
+#endif
@@ -17,247 +17,492 @@
  * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "atomic.h"
+#include "critical.h"
+#include "cycles.h"
+#include "port.h"
 #include "scheduler.h"
+#include "section.h"
+#include "trace.h"
 #include <stddef.h>
 #include <stdint.h>
 #include <stdnoreturn.h>
 
-/* Task flags */
-#define TASK_ACTIVE    (1)
+#define MAIN_STACK_LENGTH   (1024)
 
-#define THUMB_STATE     (1U << 24)
+DTCM_BSS struct task_t tasks[TASK_COUNT];
 
-#define EXC_RETURN      (0xFFFFFFFD)
+/* Also accessed by the context switch code of the port */
+DTCM_BSS struct task_t *current_task;
+DTCM_BSS struct task_t *next_task;
 
-#ifdef __FPU_PRESENT
-#define MIN_STACK_LENGTH    (128)
-#else
-#define MIN_STACK_LENGTH    (64)
+static DTCM_BSS struct task_t *scheduled_tasks;
+
+/* Tasks woken up by task_wake, in reverse order */
+static DTCM_BSS struct task_t * volatile pending_tasks;
+
+static DTCM_BSS uint8_t __attribute__((aligned(64))) main_stack[MAIN_STACK_LENGTH];
+
+static uint32_t boot_cycles;
+
+#ifdef CPU_USAGE
+/* Cycle count when runtime was last charged */
+static DTCM_BSS uint32_t cpu_usage_checkpoint;
+
+/* Cycles spent sleeping in scheduler_yield */
+static DTCM_BSS uint64_t idle_runtime;
 #endif
-#define MAIN_STACK_LENGTH   (1024)
 
-struct task_t {
-    uint32_t stack_pointer;
-#ifdef __FPU_PRESENT
-    uint32_t exception_code;
+#ifdef SWITCH_LATENCY
+/* Kind of the switch being measured */
+#define SWITCH_NONE     (0)
+#define SWITCH_YIELD    (1)
+#define SWITCH_WAKE     (2)
+
+static DTCM_BSS uint32_t switch_start;
+static DTCM_BSS volatile uint32_t switch_kind;
+static DTCM_BSS struct switch_latency_t switch_latency;
 #endif
-    enum task_status_t status;
-    struct task_t *next;
-};
 
-static struct task_t tasks[TASK_COUNT];
+/* Descriptors of tasks declared with TASK_DEFINE */
+extern const struct task_descriptor_t _stask[];
+extern const struct task_descriptor_t _etask[];
+
+void main(void);
 
 /*
- * We need to force GCC to give these variables an address,
- * and not try to optimize too much.
+ * Move tasks woken up by task_wake to the scheduled list.
+ * Must be called in a kernel critical section.
  */
-static __attribute__((used)) struct task_t *current_task;
-static __attribute__((used)) struct task_t *next_task;
+static KERNEL_RAMFUNC void scheduler_merge_pending(void)
+{
+    struct task_t *task, *list = NULL;
 
-static struct task_t *scheduled_tasks;
+    /* Take the whole pending list at once */
+    task = atomic_exchange_ptr((void * volatile *)&pending_tasks, NULL);
 
-static uint8_t __attribute__((aligned(64))) main_stack[MAIN_STACK_LENGTH];
+    /* Restore wakeup order */
+    while (task) {
+        struct task_t *next = task->pending_next;
 
-void main(void);
-
-void __attribute__((naked)) svcall_handler(void)
-{
-    __asm__ volatile(
-        ".thumb_func\n"
+        task->pending_next = list;
+        list = task;
+        task = next;
+    }
 
-        "cpsid i\n"
+    while (list) {
+        task = list;
+        list = list->pending_next;
 
-        /* Read stack pointer of current_task */
-        "ldr r1, =current_task\n"
-        "ldr r1, [r1]\n"
-        "ldr r0, [r1]\n"
+        task->wake_pending = 0;
+        task_schedule(task - tasks);
+    }
+}
 
-        /* Load context of current_task */
-        "ldmfd r0!, {r4-r11}\n"
-        "msr psp, r0\n"
+#ifdef CPU_USAGE
+/*
+ * Charge cycles elapsed since the last checkpoint to runtime.
+ * Must be called in a kernel critical section.
+ */
+static inline void cpu_usage_charge(uint64_t *runtime)
+{
+    uint32_t now = cycles_read();
 
-#ifdef __FPU_PRESENT
-        "ldr lr, [r1, #4]\n"
-#else
-        "mov lr, 0xFFFFFFFD\n"
+    *runtime += now - cpu_usage_checkpoint;
+    cpu_usage_checkpoint = now;
+}
 #endif
 
-        "cpsie i\n"
-        "bx lr\n"
-    );
+/*
+ * Put a task which was selected back in the scheduled list, before tasks
+ * of the same priority. Must be called in a kernel critical section.
+ */
+static KERNEL_RAMFUNC void scheduler_requeue(struct task_t *task)
+{
+    struct task_t **link = &scheduled_tasks;
+
+    while (*link && (*link)->priority > task->priority)
+        link = &(*link)->next;
+
+    task->next = *link;
+    *link = task;
+    task->status = TASK_SCHEDULED;
 }
 
-void __attribute__((naked)) pendsv_handler(void)
+/*
+ * Select the task to switch to, or NULL to keep running current_task.
+ * Must be called in a kernel critical section.
+ */
+static KERNEL_RAMFUNC struct task_t *scheduler_pick(void)
 {
-    __asm__ volatile(
-        ".thumb_func\n"
+    struct task_t *preempted;
 
-        "cpsid i\n"
+    scheduler_merge_pending();
 
-        /* Load current_task and next_task */
-        "ldr r0, =current_task\n"
-        "ldr r2, =next_task\n"
+    if (!scheduled_tasks)
+        return next_task;
 
-        /* Check if switching to same task */
-        "cmp r0, r2\n"
-        "beq context_switch_end\n"
+    /*
+     * Task selected by scheduler_yield: an interrupt handler may have
+     * woken up a task of higher priority before PendSV ran, which must
+     * run first.
+     */
+    if (next_task) {
+        if (scheduled_tasks->priority <= next_task->priority)
+            return next_task;
 
-        /* Dereference current_task and next_task */
-        "ldr r1, [r0]\n"
-        "ldr r3, [r2]\n"
+        scheduler_requeue(next_task);
+#ifdef SWITCH_LATENCY
+        /* The switch started by scheduler_yield does not happen */
+        switch_kind = SWITCH_NONE;
+#endif
+    } else {
+        /*
+         * An interrupt handler woke up a task. Switch to it right away if
+         * current_task is waiting for a task to be scheduled in
+         * scheduler_yield, or if it has a lower priority.
+         */
+        preempted = current_task;
+        if (preempted->status != TASK_STOPPED
+        &&  scheduled_tasks->priority <= preempted->priority)
+            return NULL;
+
+        /* A preempted task runs again before tasks of the same priority */
+        if (preempted->status == TASK_RUNNING)
+            scheduler_requeue(preempted);
+    }
 
-        /* Save context of current_task */
-        "mrs r12, psp\n"
+    next_task = scheduled_tasks;
+    scheduled_tasks = scheduled_tasks->next;
+    next_task->next = NULL;
+    next_task->status = TASK_RUNNING;
 
-#ifdef __FPU_PRESENT
-        "tst lr, #0x00000010\n"
-        "it eq\n"
-        "vstmdbeq r12!, {s16-s31}\n"
-        "str lr, [r1, #4]\n"   /* Save exception code */
+    return next_task;
+}
+
+KERNEL_RAMFUNC struct task_t *scheduler_select(void)
+{
+    struct task_t *task = scheduler_pick();
+
+    if (task && task != current_task) {
+#ifdef CPU_USAGE
+        cpu_usage_charge(&current_task->runtime);
 #endif
-        "stmfd r12!, {r4-r11}\n"
-        "str r12, [r1]\n"
+        TRACE_EVENT(TRACE_SWITCH, task - tasks, current_task - tasks);
+    }
 
-        /* Load context of next_task */
-        "ldr r1, [r3]\n"
-        "ldmfd r1!, {r4-r11}\n"
-#ifdef __FPU_PRESENT
-        "ldr lr, [r3, #4]\n"    /* Load exception code */
-        "tst lr, #0x00000010\n"
-        "it eq\n"
-        "vldmiaeq r1!, {s16-s31}\n"
+#ifdef SWITCH_LATENCY
+    /* Only tasks resuming in scheduler_yield can record the latency */
+    if (!task || task == current_task || !task->yielded)
+        switch_kind = SWITCH_NONE;
 #endif
-        "msr psp, r1\n"
 
-        /* Set current_task to next_task */
-        "str r3, [r0]\n"
+    return task;
+}
 
-        "context_switch_end:\n"
+#ifdef SWITCH_LATENCY
+/*
+ * Record the latency of the switch to current_task, if it was measured.
+ * Called by current_task when it resumes in scheduler_yield.
+ */
+static KERNEL_RAMFUNC void switch_latency_record(uint32_t end)
+{
+    critical_state_t state;
 
-        /* Set next_task to NULL */
-        "mov r1, #0\n"
-        "str r1, [r2]\n"
+    state = critical_enter();
 
-        "cpsie i\n"
-        "bx lr\n"
-    );
-}
+    current_task->yielded = 0;
+    if (switch_kind != SWITCH_NONE) {
+        unsigned int bucket = 32 - __CLZ(end - switch_start);
 
-/* Force GCC not to generate code for the stack */
-static noreturn void stop_task(void)
-{
-    /*
-     * We reach this function if the task returns from the entry point.
-     * In other words, the task finished its job.
-     */
-    scheduler_yield();
-    __builtin_unreachable();
+        if (bucket >= SWITCH_LATENCY_BUCKETS)
+            bucket = SWITCH_LATENCY_BUCKETS - 1;
+
+        if (switch_kind == SWITCH_YIELD)
+            switch_latency.yield[bucket]++;
+        else
+            switch_latency.wake[bucket]++;
+
+        switch_kind = SWITCH_NONE;
+    }
+
+    critical_exit(state);
 }
+#endif
 
 noreturn void scheduler_start(void)
 {
-    NVIC_SetPriority(PendSV_IRQn, 255);
+    const struct task_descriptor_t *desc;
+
+#ifdef TRACE
+    trace_init();
+#endif
+
+    port_init();
 
     /*
-     * 1. Create main and idle tasks
+     * 1. Create main task and tasks declared with TASK_DEFINE
      * 2. Select main task
-     * 3. Trigger SVC interrupt to start main task
+     * 3. Let the port switch to main task
      */
     task_create(MAIN_TASK_ID, main, main_stack, MAIN_STACK_LENGTH);
 
+    for (desc = _stask; desc < _etask; ++desc) {
+        task_create(desc->id, desc->entrypoint, desc->stack, desc->stack_size);
+        task_set_priority(desc->id, desc->priority);
+        if (desc->status == TASK_SCHEDULED)
+            task_schedule(desc->id);
+    }
+
     current_task = &tasks[MAIN_TASK_ID];
     current_task->status = TASK_RUNNING;
     next_task = NULL;
-    __asm__ volatile ("cpsie i" : : : "memory");
-    __asm__ volatile ("svc 0");
-
-    __builtin_unreachable();
+    boot_cycles = cycles_read();
+#ifdef CPU_USAGE
+    cpu_usage_checkpoint = boot_cycles;
+#endif
+    port_start();
 }
 
-void scheduler_yield(void)
+KERNEL_RAMFUNC void scheduler_yield(void)
 {
-scheduler_yield_start:
+    critical_state_t state;
+#ifdef SWITCH_LATENCY
+    uint32_t start = cycles_read();
+    uint32_t kind = SWITCH_YIELD;
+#endif
 
-    __asm__ volatile ("cpsid i" : : : "memory");
+    state = critical_enter();
 
-    current_task->status = TASK_STOPPED;
+#ifdef SWITCH_LATENCY
+    current_task->yielded = 1;
+#endif
 
-    if (scheduled_tasks) {
-        next_task = scheduled_tasks;
-        scheduled_tasks = scheduled_tasks->next;
-        next_task->next = NULL;
+    /* A task scheduled while running stays in the scheduled list */
+    if (current_task->status == TASK_RUNNING) {
+        current_task->status = TASK_STOPPED;
+        TRACE_EVENT(TRACE_BLOCK, current_task - tasks, 0);
     }
 
-    if (next_task) {
-        next_task->status = TASK_RUNNING;
-        SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
-        __asm__ volatile ("cpsie i" : : : "memory");
-    }  else {
-        __asm__ volatile ("wfi" ::: "memory");
-        __asm__ volatile ("cpsie i" : : : "memory");
-        goto scheduler_yield_start;
+    scheduler_merge_pending();
+
+    while (!scheduled_tasks) {
+        /*
+         * Interrupts masked by BASEPRI do not wake up the core, so sleep
+         * with PRIMASK set instead. Pending interrupts are taken as soon
+         * as PRIMASK is cleared.
+         */
+        port_irq_disable();
+        critical_exit(state);
+#ifdef SWITCH_LATENCY
+        /* Sleeping is not part of the switch latency */
+        kind = SWITCH_NONE;
+#endif
+#ifdef CPU_USAGE
+        cpu_usage_charge(&current_task->runtime);
+        port_wait_for_interrupt();
+        cpu_usage_charge(&idle_runtime);
+#else
+        port_wait_for_interrupt();
+#endif
+        port_irq_enable();
+
+        state = critical_enter();
+
+        /*
+         * pendsv_handler may have switched directly to a task woken up
+         * by an interrupt handler, and later back to this task.
+         */
+        if (current_task->status == TASK_RUNNING) {
+            critical_exit(state);
+            goto scheduler_yield_end;
+        }
+
+        scheduler_merge_pending();
     }
+
+    next_task = scheduled_tasks;
+    scheduled_tasks = scheduled_tasks->next;
+    next_task->next = NULL;
+    next_task->status = TASK_RUNNING;
+#ifdef SWITCH_LATENCY
+    switch_start = start;
+    switch_kind = kind;
+#endif
+    port_trigger_switch();
+    critical_exit(state);
+
+scheduler_yield_end:
+
+#ifdef SWITCH_LATENCY
+    switch_latency_record(cycles_read());
+#endif
+
+    port_task_resumed();
 }
 
 void task_create(unsigned int id, void (*entrypoint)(void), void *stack, uint32_t stack_size)
 {
-    uint32_t *sp;
+    port_task_init(id, entrypoint, stack, stack_size);
+    tasks[id].status = TASK_STOPPED;
+    tasks[id].priority = 0;
+    tasks[id].wake_pending = 0;
+#ifdef CPU_USAGE
+    tasks[id].runtime = 0;
+#endif
+#ifdef SWITCH_LATENCY
+    tasks[id].yielded = 0;
+#endif
+}
 
-    sp = (uint32_t *)((uint32_t)stack + stack_size);
+void task_set_priority(unsigned int id, unsigned int priority)
+{
+    tasks[id].priority = priority;
+}
 
-    /*
-     * xPSR, PC, LR, R12, R3, R2, R1, R0 are restored by the
-     * hardware upon leaving exception mode.
-     */
-    *--sp = ((uint32_t)entrypoint & 0x1) ? THUMB_STATE : 0;
-    *--sp = (uint32_t)entrypoint;
-    *--sp = (uint32_t)stop_task;
-    *--sp = 12;
-    *--sp = 3;
-    *--sp = 2;
-    *--sp = 1;
-    *--sp = 0;
-
-    /* R4-R11 need to be manually restored */
-    *--sp = 11;
-    *--sp = 10;
-    *--sp = 9;
-    *--sp = 8;
-    *--sp = 7;
-    *--sp = 6;
-    *--sp = 5;
-    *--sp = 4;
-
-    tasks[id].stack_pointer = (uint32_t)sp;
+void task_set_integer_only(unsigned int id)
+{
 #ifdef __FPU_PRESENT
-    tasks[id].exception_code = EXC_RETURN;
+    tasks[id].fpu_flags = TASK_NO_FPU;
+#else
+    (void)id;
 #endif
-    tasks[id].status = TASK_STOPPED;
 }
 
-void task_schedule(unsigned int id)
+KERNEL_RAMFUNC void task_schedule(unsigned int id)
 {
-    if (scheduled_tasks) {
-        struct task_t *tail;
+    struct task_t *task = &tasks[id];
+    critical_state_t state;
+
+    state = critical_enter();
+
+    if (task->status != TASK_SCHEDULED) {
+        struct task_t **link;
 
         /*
-         * Append to the end of the list. We assume
+         * Insert after all tasks of same or higher priority. We assume
          * that the scheduled list will never be very long.
          */
-        tail = scheduled_tasks;
-        while (tail->next)
-            tail = tail->next;
-
-        tail->next = &tasks[id];
-    } else {
-        scheduled_tasks = &tasks[id];
+        link = &scheduled_tasks;
+        while (*link && (*link)->priority >= task->priority)
+            link = &(*link)->next;
+
+        task->next = *link;
+        *link = task;
+        task->status = TASK_SCHEDULED;
+        TRACE_EVENT(TRACE_READY, id, 0);
     }
 
-    tasks[id].status = TASK_SCHEDULED;
-    tasks[id].next = NULL;
+    critical_exit(state);
 }
 
 enum task_status_t task_get_status(unsigned int id)
 {
     return tasks[id].status;
 }
+
+KERNEL_RAMFUNC int task_wake(unsigned int id)
+{
+    struct task_t *task = &tasks[id];
+    struct task_t *head;
+
+    /* Do not push the task twice before the list is merged */
+    if (atomic_exchange_u32(&task->wake_pending, 1))
+        return 0;
+
+    do {
+        head = pending_tasks;
+        task->pending_next = head;
+    } while (atomic_compare_exchange_ptr((void * volatile *)&pending_tasks, head, task) != head);
+
+    TRACE_EVENT(TRACE_READY, id, 1);
+
+    /*
+     * PendSV has the lowest priority: it tail-chains after the interrupt
+     * handlers and switches directly to the woken up task. Otherwise,
+     * the task is scheduled the next time current_task yields.
+     */
+    if (current_task->status == TASK_STOPPED
+    ||  task->priority > current_task->priority) {
+#ifdef SWITCH_LATENCY
+        /* Measure from the first wakeup if several tasks are woken up */
+        if (switch_kind == SWITCH_NONE) {
+            switch_start = cycles_read();
+            switch_kind = SWITCH_WAKE;
+        }
+#endif
+        port_trigger_switch();
+        return 1;
+    }
+
+    return 0;
+}
+
+unsigned int task_get_current(void)
+{
+    return current_task - tasks;
+}
+
+uint32_t scheduler_get_boot_cycles(void)
+{
+    return boot_cycles;
+}
+
+#ifdef CPU_USAGE
+void cpu_usage_get(struct cpu_usage_t *usage)
+{
+    critical_state_t state;
+    unsigned int i;
+
+    state = critical_enter();
+
+    /* Include cycles of the running task since the last switch */
+    cpu_usage_charge(&current_task->runtime);
+
+    for (i = 0; i < TASK_COUNT; ++i)
+        usage->runtime[i] = tasks[i].runtime;
+    usage->runtime[CPU_USAGE_IDLE] = idle_runtime;
+
+    critical_exit(state);
+}
+
+unsigned int cpu_usage_percent(const struct cpu_usage_t *start,
+                               const struct cpu_usage_t *end,
+                               unsigned int id)
+{
+    uint64_t total = 0;
+    unsigned int i;
+
+    for (i = 0; i <= CPU_USAGE_IDLE; ++i)
+        total += end->runtime[i] - start->runtime[i];
+
+    if (!total)
+        return 0;
+
+    return (100 * (end->runtime[id] - start->runtime[id])) / total;
+}
+#endif
+
+#ifdef SWITCH_LATENCY
+void switch_latency_get(struct switch_latency_t *histograms)
+{
+    critical_state_t state;
+
+    state = critical_enter();
+    *histograms = switch_latency;
+    critical_exit(state);
+}
+
+void switch_latency_reset(void)
+{
+    critical_state_t state;
+    unsigned int i;
+
+    state = critical_enter();
+    for (i = 0; i < SWITCH_LATENCY_BUCKETS; ++i) {
+        switch_latency.yield[i] = 0;
+        switch_latency.wake[i] = 0;
+    }
+    critical_exit(state);
+}
+#endif
@@ -20,6 +20,7 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include "section.h"
 #include <stdint.h>
 
 #ifndef TASK_COUNT
@@ -28,23 +29,77 @@
 
 #define MAIN_TASK_ID    (0)
 
+/*
+ * NVIC priority level from which interrupts are masked in kernel critical
+ * sections. Interrupts with a numerically lower (more urgent) priority are
+ * never delayed by the kernel, but must not call any kernel function.
+ */
+#ifndef SCHEDULER_IRQ_PRIORITY
+#define SCHEDULER_IRQ_PRIORITY      (4)
+#endif
+
 enum task_status_t {
     TASK_STOPPED,
     TASK_SCHEDULED,
     TASK_RUNNING,
 };
 
+struct task_descriptor_t {
+    unsigned int id;
+    void (*entrypoint)(void);
+    void *stack;
+    uint32_t stack_size;
+    unsigned int priority;
+    enum task_status_t status;
+};
+
+/**
+ * @brief Declare a task created by scheduler_start
+ *
+ * The descriptor is placed in the .task section, which scheduler_start
+ * walks to create all tasks before switching to the main task. The stack
+ * is placed in DTCM when available.
+ *
+ * @param name Prefix of the stack and descriptor variables
+ * @param _id Must be less than TASK_COUNT and not MAIN_TASK_ID
+ * @param _entrypoint
+ * @param _stack_size Must be a multiple of 8
+ * @param _priority
+ * @param _status TASK_SCHEDULED to schedule the task, TASK_STOPPED otherwise
+ */
+#define TASK_DEFINE(name, _id, _entrypoint, _stack_size, _priority, _status)    \
+    static DTCM_BSS uint8_t __attribute__((aligned(8))) name##_stack[_stack_size]; \
+    static const struct task_descriptor_t name##_descriptor                     \
+    __attribute__((used, section(TASK_SECTION))) = {                            \
+        .id = (_id),                                                            \
+        .entrypoint = (_entrypoint),                                            \
+        .stack = name##_stack,                                                  \
+        .stack_size = (_stack_size),                                            \
+        .priority = (_priority),                                                \
+        .status = (_status),                                                    \
+    }
+
 /**
  * @brief Start scheduler
  *
- * Create main task and start it.
+ * Create main task and tasks declared with TASK_DEFINE, then start
+ * main task.
  */
 void scheduler_start(void);
 
+/**
+ * @return Number of cycles from reset to the first task switch
+ */
+uint32_t scheduler_get_boot_cycles(void);
+
 /**
  * @brief Yield current task
+ *
+ * The highest priority scheduled task runs next. The current task runs
+ * again once scheduled by task_schedule or task_wake. If no task is
+ * scheduled, the core sleeps until an interrupt handler wakes up a task.
  */
-void scheduler_yield(void);
+KERNEL_RAMFUNC void scheduler_yield(void);
 
 /**
  * @Brief Create a task
@@ -59,12 +114,64 @@ void scheduler_yield(void);
  */
 void task_create(unsigned int id, void (*entrypoint)(void), void *stack, uint32_t stack_size);
 
+/**
+ * @brief Declare a task as integer-only
+ *
+ * The FPU is disabled while the task runs, so that switching to and from
+ * this task never saves FPU registers. If the task executes an FPU
+ * instruction anyway, a UsageFault is raised and the task ID is recorded
+ * in fpu_fault_task. Interrupt handlers must not use the FPU either while
+ * an integer-only task runs.
+ *
+ * Must be called after task_create and before the task is scheduled.
+ *
+ * @param[in] id
+ */
+void task_set_integer_only(unsigned int id);
+
+/**
+ * @brief Set task priority
+ *
+ * Scheduled tasks run by decreasing priority, and in scheduling order
+ * among tasks of the same priority. All tasks have priority 0 when
+ * created. Tasks yield to each other, except that a task woken up by
+ * task_wake preempts a running task of lower priority.
+ *
+ * @param[in] id
+ * @param[in] priority
+ */
+void task_set_priority(unsigned int id, unsigned int priority);
+
 /**
  * @brief Add task to scheduled task list
  *
+ * Scheduling a task which is already scheduled has no effect. Scheduling
+ * the running task makes it run again after it yields.
+ *
+ * Can be called from interrupt handlers whose priority is not higher
+ * than SCHEDULER_IRQ_PRIORITY, but task_wake is preferred there.
+ *
+ * @param[in] id
+ */
+KERNEL_RAMFUNC void task_schedule(unsigned int id);
+
+/**
+ * @brief Schedule a task from an interrupt handler
+ *
+ * The task is pushed to a lock-free pending list, which is moved to the
+ * scheduled list when the running task yields or when PendSV runs.
+ * Interrupts are never masked, so this can be called from any interrupt
+ * handler and from tasks.
+ *
+ * If the task has a higher priority than the running task, or if no task
+ * is running, PendSV is triggered: once interrupt handlers return, it
+ * switches directly to the woken up task. Several wakeups in a row are
+ * handled by a single PendSV.
+ *
  * @param[in] id
+ * @return 1 if a context switch was triggered, 0 otherwise
  */
-void task_schedule(unsigned int id);
+KERNEL_RAMFUNC int task_wake(unsigned int id);
 
 /**
  * @param[in] id
@@ -72,4 +179,78 @@ void task_schedule(unsigned int id);
  */
 enum task_status_t task_get_status(unsigned int id);
 
+/**
+ * @return ID of the running task
+ */
+unsigned int task_get_current(void);
+
+#ifdef CPU_USAGE
+
+/* Index of the time spent sleeping in struct cpu_usage_t */
+#define CPU_USAGE_IDLE      (TASK_COUNT)
+
+/*
+ * Cycles each task ran for since it was created. Time spent in interrupt
+ * handlers is charged to the interrupted task. A task must not run for
+ * more than 2^32 cycles without switching, or its runtime wraps around.
+ */
+struct cpu_usage_t {
+    uint64_t runtime[TASK_COUNT + 1];
+};
+
+/**
+ * @brief Take a snapshot of task runtimes
+ *
+ * @param[out] usage
+ */
+void cpu_usage_get(struct cpu_usage_t *usage);
+
+/**
+ * @brief Compute the CPU usage of a task between two snapshots
+ *
+ * @param[in] start
+ * @param[in] end
+ * @param[in] id Task ID, or CPU_USAGE_IDLE
+ * @return Percentage of cycles used by the task
+ */
+unsigned int cpu_usage_percent(const struct cpu_usage_t *start,
+                               const struct cpu_usage_t *end,
+                               unsigned int id);
+
+#endif
+
+#ifdef SWITCH_LATENCY
+
+#define SWITCH_LATENCY_BUCKETS      (16)
+
+/*
+ * Histograms of context switch latencies, in cycles. Bucket 0 counts
+ * switches of 0 cycles, bucket n counts switches of 2^(n-1) to 2^n - 1
+ * cycles, and the last bucket also counts all longer switches.
+ *
+ * yield: from a call to scheduler_yield to the next task resuming
+ * wake: from a call to task_wake which triggers a switch to the woken up
+ * task resuming
+ *
+ * Only switches to tasks resuming in scheduler_yield are measured.
+ */
+struct switch_latency_t {
+    uint32_t yield[SWITCH_LATENCY_BUCKETS];
+    uint32_t wake[SWITCH_LATENCY_BUCKETS];
+};
+
+/**
+ * @brief Read context switch latency histograms
+ *
+ * @param[out] histograms
+ */
+void switch_latency_get(struct switch_latency_t *histograms);
+
+/**
+ * @brief Clear context switch latency histograms
+ */
+void switch_latency_reset(void);
+
+#endif
+
 #endif
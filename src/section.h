@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SECTION_H
+#define SECTION_H
+
+/*
+ * Zero-initialized data that must live in tightly coupled data memory.
+ * DTCM is accessed with zero wait state and is not cached, which makes
+ * it the best place for kernel state and hot task stacks. On boards
+ * without DTCM, data goes to the regular bss section.
+ */
+#ifdef HAVE_DTCM
+#define DTCM_BSS        __attribute__((section(".dtcm_bss")))
+#else
+#define DTCM_BSS
+#endif
+
+/*
+ * Data which is not cleared at boot, for large buffers that are always
+ * written before being read.
+ */
+#define NOINIT          __attribute__((section(".noinit")))
+
+/*
+ * Section of task descriptors declared with TASK_DEFINE, from _stask to
+ * _etask. The host port uses a section name which is a valid C identifier,
+ * for which the linker defines start and end symbols.
+ */
+#ifndef TASK_SECTION
+#define TASK_SECTION    ".task"
+#endif
+
+/*
+ * Kernel hot path. When built with KERNEL_IN_RAM=1, these functions are
+ * collected in the .ramfunc section which is copied at boot to ITCM, or to
+ * SRAM on boards without ITCM, so that they do not suffer flash wait states.
+ * RAM is out of range of a BL instruction located in flash, hence long_call.
+ */
+#ifdef KERNEL_IN_RAM
+#define KERNEL_RAMFUNC  __attribute__((section(".ramfunc"), long_call, noinline))
+#else
+#define KERNEL_RAMFUNC
+#endif
+
+#endif
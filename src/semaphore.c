@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "atomic.h"
+#include "scheduler.h"
+#include "semaphore.h"
+
+_Static_assert(TASK_COUNT <= 32, "waiting_tasks cannot hold more than 32 tasks");
+
+void semaphore_init(struct semaphore_t *sem, uint32_t count)
+{
+    sem->count = count;
+    sem->waiting_tasks = 0;
+}
+
+void semaphore_give(struct semaphore_t *sem)
+{
+    uint32_t waiting;
+
+    atomic_fetch_add_u32(&sem->count, 1);
+
+    waiting = atomic_exchange_u32(&sem->waiting_tasks, 0);
+    while (waiting) {
+        unsigned int id = 31 - __CLZ(waiting);
+
+        waiting &= ~(1U << id);
+        task_wake(id);
+    }
+}
+
+int semaphore_try_take(struct semaphore_t *sem)
+{
+    uint32_t count = sem->count;
+
+    while (count) {
+        uint32_t old = atomic_compare_exchange_u32(&sem->count, count, count - 1);
+
+        if (old == count)
+            return 0;
+        count = old;
+    }
+
+    return -1;
+}
+
+void semaphore_take(struct semaphore_t *sem)
+{
+    uint32_t mask = 1U << task_get_current();
+
+    while (semaphore_try_take(sem)) {
+        atomic_set_bits_u32(&sem->waiting_tasks, mask);
+
+        /* The semaphore may have been given before this task was registered */
+        if (!semaphore_try_take(sem)) {
+            atomic_clear_bits_u32(&sem->waiting_tasks, mask);
+            break;
+        }
+
+        scheduler_yield();
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include <stdint.h>
+
+/*
+ * Counting semaphore. Interrupts are never masked: semaphore_give and
+ * semaphore_try_take can be called from any interrupt handler.
+ */
+
+struct semaphore_t {
+    volatile uint32_t count;
+    volatile uint32_t waiting_tasks;    /* Bit n set if task n waits */
+};
+
+/**
+ * @brief Initialize semaphore
+ *
+ * @param[out] sem
+ * @param[in] count Initial count
+ */
+void semaphore_init(struct semaphore_t *sem, uint32_t count);
+
+/**
+ * @brief Increment semaphore count
+ *
+ * Tasks waiting in semaphore_take are woken up.
+ *
+ * @param[in] sem
+ */
+void semaphore_give(struct semaphore_t *sem);
+
+/**
+ * @brief Decrement semaphore count if it is not zero
+ *
+ * @param[in] sem
+ * @return 0 if successful, -1 if the count is zero
+ */
+int semaphore_try_take(struct semaphore_t *sem);
+
+/**
+ * @brief Decrement semaphore count, yield until it is not zero
+ *
+ * Must only be called from a task.
+ *
+ * @param[in] sem
+ */
+void semaphore_take(struct semaphore_t *sem);
+
+#endif
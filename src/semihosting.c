@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "semihosting.h"
+
+#define SYS_WRITE0      (0x04)
+#define SYS_EXIT        (0x18)
+
+/* Reasons passed to SYS_EXIT */
+#define ADP_STOPPED_RUNTIME_ERROR       (0x20023)
+#define ADP_STOPPED_APPLICATION_EXIT    (0x20026)
+
+static uint32_t semihosting_call(uint32_t operation, const void *arg)
+{
+    register uint32_t r0 __asm__("r0") = operation;
+    register const void *r1 __asm__("r1") = arg;
+
+    __asm__ volatile ("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+
+    return r0;
+}
+
+void semihosting_write(const char *str)
+{
+    semihosting_call(SYS_WRITE0, str);
+}
+
+void semihosting_write_u32(uint32_t value)
+{
+    char buffer[11];
+    char *str = &buffer[sizeof(buffer) - 1];
+
+    *str = '\0';
+    do {
+        *--str = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    semihosting_write(str);
+}
+
+void semihosting_write_u64(uint64_t value)
+{
+    char buffer[21];
+    char *str = &buffer[sizeof(buffer) - 1];
+
+    *str = '\0';
+    do {
+        *--str = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    semihosting_write(str);
+}
+
+noreturn void semihosting_exit(int status)
+{
+    uint32_t reason = status ? ADP_STOPPED_RUNTIME_ERROR : ADP_STOPPED_APPLICATION_EXIT;
+
+    while (1)
+        semihosting_call(SYS_EXIT, (const void *)reason);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEMIHOSTING_H
+#define SEMIHOSTING_H
+
+#include <stdint.h>
+#include <stdnoreturn.h>
+
+/*
+ * ARM semihosting: output goes to the debugger console, or to the
+ * terminal when running under QEMU with -semihosting. Semihosting calls
+ * are BKPT instructions: without a debugger, they raise a HardFault.
+ */
+
+/**
+ * @brief Write a string to the host console
+ *
+ * @param[in] str
+ */
+void semihosting_write(const char *str);
+
+/**
+ * @brief Write an unsigned integer in decimal to the host console
+ *
+ * @param[in] value
+ */
+void semihosting_write_u32(uint32_t value);
+
+/**
+ * @brief Write a 64-bit unsigned integer in decimal to the host console
+ *
+ * @param[in] value
+ */
+void semihosting_write_u64(uint64_t value);
+
+/**
+ * @brief Stop the program
+ *
+ * QEMU exits with status 0 if status is 0, and 1 otherwise.
+ *
+ * @param[in] status
+ */
+noreturn void semihosting_exit(int status);
+
+#endif
@@ -17,9 +17,12 @@
  * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "cycles.h"
+#include "irq.h"
 #include "scheduler.h"
 #include <stdnoreturn.h>
 #include <stdint.h>
+#include <string.h>
 
 extern uint32_t _end_stack;
 extern uint32_t _end_text;
@@ -27,26 +30,55 @@ extern uint32_t _start_data;
 extern uint32_t _end_data;
 extern uint32_t _start_bss;
 extern uint32_t _end_bss;
+#ifdef HAVE_ITCM
+extern uint32_t _load_itcm;
+extern uint32_t _start_itcm;
+extern uint32_t _end_itcm;
+#endif
+#ifdef HAVE_DTCM
+extern uint32_t _start_dtcm_bss;
+extern uint32_t _end_dtcm_bss;
+#endif
 
 noreturn void reset_handler(void)
 {
-    register uint32_t *src, *dst;
+    /* Start counting cycles as early as possible to measure boot time */
+    cycles_init();
+
+    /*
+     * Copy data section from flash to RAM. The C library copies and
+     * clears memory with multi-word loads and stores, which is much
+     * faster than a word-by-word loop.
+     */
+    memcpy(&_start_data, &_end_text, (uint32_t)&_end_data - (uint32_t)&_start_data);
 
-    /* Copy data section from flash to RAM */
-    src = &_end_text;
-    dst = &_start_data;
-    while (dst < &_end_data)
-        *dst++ = *src++;
+#ifdef HAVE_ITCM
+    /* Copy code that runs from ITCM */
+    memcpy(&_start_itcm, &_load_itcm, (uint32_t)&_end_itcm - (uint32_t)&_start_itcm);
+#endif
+
+    /* Clear the bss section, .noinit is left untouched */
+    memset(&_start_bss, 0, (uint32_t)&_end_bss - (uint32_t)&_start_bss);
 
-    /* Clear the bss section, assumes .bss goes directly after .data */
-    dst = &_start_bss;
-    while (dst < &_end_bss)
-        *dst++ = 0;
+#ifdef HAVE_DTCM
+    /* Clear the bss section placed in DTCM */
+    memset(&_start_dtcm_bss, 0, (uint32_t)&_end_dtcm_bss - (uint32_t)&_start_dtcm_bss);
+#endif
 
 #ifdef __FPU_PRESENT
     SCB->CPACR |= 0x00f00000;
 #endif
 
+#if defined(__ICACHE_PRESENT) && (__ICACHE_PRESENT == 1U)
+    SCB_EnableICache();
+#endif
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    /* Drivers must use cache.h helpers for DMA buffers */
+    SCB_EnableDCache();
+#endif
+
+    irq_init();
+
     scheduler_start();
     __builtin_unreachable();
 }
@@ -59,16 +91,24 @@ void default_handler(void)
 
 void nmi_handler(void) __attribute__((weak, alias("default_handler")));
 void hardfault_handler(void) __attribute__((weak, alias("default_handler")));
+void usagefault_handler(void) __attribute__((weak, alias("default_handler")));
 void svcall_handler(void) __attribute__((weak, alias("default_handler")));
 void pendsv_handler(void) __attribute__((weak, alias("default_handler")));
 void systick_handler(void) __attribute__((weak, alias("default_handler")));
+void irq_handler(void) __attribute__((weak, alias("default_handler")));
 
 void * const core_vector_table[16] __attribute__ ((section(".cortex_vectors"))) = {
     [0] = &_end_stack,
     [1] = reset_handler,
     [2] = nmi_handler,
     [3] = hardfault_handler,
+    [6] = usagefault_handler,
     [11] = svcall_handler,
     [14] = pendsv_handler,
     [15] = systick_handler,
 };
+
+/* Default handler of vendor interrupts, see irq_register */
+void * const vendor_vector_table[VENDOR_IRQ_COUNT] __attribute__ ((section(".vendor_vectors"))) = {
+    [0 ... VENDOR_IRQ_COUNT - 1] = irq_handler,
+};
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "section.h"
+#include "trace.h"
+
+/* Not cleared at boot, so that events survive a warm reset */
+NOINIT struct trace_buffer_t trace_buffer;
+
+void trace_init(void)
+{
+    unsigned int i;
+
+    if (trace_buffer.magic == TRACE_MAGIC)
+        return;
+
+    for (i = 0; i < TRACE_LENGTH; ++i)
+        trace_buffer.records[i].event = 0;
+    trace_buffer.index = 0;
+    trace_buffer.magic = TRACE_MAGIC;
+}
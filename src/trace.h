@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "atomic.h"
+#include "cycles.h"
+#include <stdint.h>
+
+/*
+ * Scheduler event trace. When built with TRACE=1, events are written to
+ * a ring buffer in RAM, trace_buffer, which is not cleared by a warm
+ * reset. tools/trace2json.py converts a dump of it to a timeline.
+ * Otherwise, TRACE_EVENT compiles to nothing.
+ */
+
+#ifndef TRACE_LENGTH
+#define TRACE_LENGTH    (256)
+#endif
+
+_Static_assert((TRACE_LENGTH & (TRACE_LENGTH - 1)) == 0, "TRACE_LENGTH must be a power of two");
+
+#define TRACE_MAGIC     (0x54524345)
+
+enum trace_event_t {
+    TRACE_SWITCH = 1,   /* Switch to task, arg is the previous task */
+    TRACE_READY,        /* Task scheduled, arg is 1 if woken up by task_wake */
+    TRACE_BLOCK,        /* Task yielded without being scheduled */
+    TRACE_ISR_ENTER,    /* Interrupted task, arg is the exception number */
+    TRACE_ISR_EXIT,     /* Interrupted task, arg is the exception number */
+    TRACE_TIMER,        /* Timer fired, arg is defined by the application */
+};
+
+struct trace_record_t {
+    uint32_t timestamp;     /* DWT cycle counter */
+    uint8_t event;
+    uint8_t task;
+    uint16_t arg;
+};
+
+struct trace_buffer_t {
+    uint32_t magic;
+    volatile uint32_t index;    /* Total number of events written */
+    struct trace_record_t records[TRACE_LENGTH];
+};
+
+extern struct trace_buffer_t trace_buffer;
+
+/**
+ * @brief Initialize trace buffer after a cold reset
+ *
+ * Events recorded before a warm reset are kept.
+ */
+void trace_init(void);
+
+/**
+ * @brief Record an event
+ *
+ * Never masks interrupts: each writer reserves a record by incrementing
+ * the index atomically, so this can be called from any interrupt handler.
+ *
+ * @param[in] event
+ * @param[in] task
+ * @param[in] arg
+ */
+static inline void trace_event(enum trace_event_t event, unsigned int task, unsigned int arg)
+{
+    uint32_t index = atomic_fetch_add_u32(&trace_buffer.index, 1);
+    struct trace_record_t *record = &trace_buffer.records[index & (TRACE_LENGTH - 1)];
+
+    /*
+     * The event is written last, so that a record which is not complete
+     * when the buffer is dumped is skipped by tools/trace2json.py.
+     */
+    record->event = 0;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    record->timestamp = cycles_read();
+    record->task = task;
+    record->arg = arg;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    record->event = event;
+}
+
+#ifdef TRACE
+#define TRACE_EVENT(event, task, arg)   trace_event((event), (task), (arg))
+#else
+#define TRACE_EVENT(event, task, arg)   ((void)0)
+#endif
+
+/* Call at the beginning and at the end of interrupt handlers */
+#define TRACE_ISR_ENTER()   TRACE_EVENT(TRACE_ISR_ENTER, task_get_current(), __get_IPSR())
+#define TRACE_ISR_EXIT()    TRACE_EVENT(TRACE_ISR_EXIT, task_get_current(), __get_IPSR())
+
+#endif
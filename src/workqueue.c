@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "critical.h"
+#include "scheduler.h"
+#include "workqueue.h"
+
+/* Worker tasks find their queue from their task ID */
+static struct workqueue_t *workqueues[TASK_COUNT];
+
+static void workqueue_worker(void)
+{
+    struct workqueue_t *wq = workqueues[task_get_current()];
+
+    while (1) {
+        unsigned int count = 0;
+
+        /*
+         * The slot is released only once the work is done, so
+         * that a producer cannot overwrite it in the meantime.
+         */
+        while (count < wq->batch && wq->head != wq->tail) {
+            struct work_t *work = &wq->items[wq->head & (wq->length - 1)];
+
+            work->function(work->arg);
+            wq->head++;
+            ++count;
+        }
+
+        /* Let other tasks run before processing the next batch */
+        if (wq->head != wq->tail)
+            task_schedule(wq->task_id);
+
+        /*
+         * Sleep until work is posted. If work was posted since the
+         * queue was found empty, the worker is already scheduled.
+         */
+        scheduler_yield();
+    }
+}
+
+void workqueue_init(struct workqueue_t *wq, unsigned int task_id, unsigned int priority,
+                    struct work_t *items, uint32_t length, unsigned int batch,
+                    void *stack, uint32_t stack_size)
+{
+    wq->items = items;
+    wq->length = length;
+    wq->head = 0;
+    wq->tail = 0;
+    wq->task_id = task_id;
+    wq->batch = batch;
+
+    workqueues[task_id] = wq;
+    task_create(task_id, workqueue_worker, stack, stack_size);
+    task_set_priority(task_id, priority);
+}
+
+int workqueue_post(struct workqueue_t *wq, void (*function)(void *arg), void *arg)
+{
+    critical_state_t state;
+    struct work_t *work;
+
+    state = critical_enter();
+
+    if (wq->tail - wq->head == wq->length) {
+        critical_exit(state);
+        return -1;
+    }
+
+    work = &wq->items[wq->tail & (wq->length - 1)];
+    work->function = function;
+    work->arg = arg;
+    wq->tail++;
+
+    critical_exit(state);
+
+    task_wake(wq->task_id);
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2019  Francois Berder <fberder@outlook.fr>
+ *
+ * This file is part of multithreading.
+ *
+ * multithreading is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multithreading is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with multithreading.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stdint.h>
+
+/*
+ * Work queues let interrupt handlers defer processing to task context.
+ * Each work queue is drained by its own worker task, so several queues
+ * can be served at different priorities.
+ */
+
+struct work_t {
+    void (*function)(void *arg);
+    void *arg;
+};
+
+struct workqueue_t {
+    struct work_t *items;
+    uint32_t length;
+    volatile uint32_t head;     /* Next item to process */
+    volatile uint32_t tail;     /* Next free slot */
+    unsigned int task_id;
+    unsigned int batch;
+};
+
+/**
+ * @brief Initialize a work queue and create its worker task
+ *
+ * The worker task is scheduled when work is posted. It processes up to
+ * batch items before letting other tasks run.
+ *
+ * @param[out] wq
+ * @param[in] task_id ID of the worker task, must be less than TASK_COUNT
+ * @param[in] priority Priority of the worker task
+ * @param[in] items Storage for pending work items
+ * @param[in] length Number of items, must be a power of two
+ * @param[in] batch Maximum number of items processed per wakeup
+ * @param[in] stack Stack of the worker task
+ * @param[in] stack_size
+ */
+void workqueue_init(struct workqueue_t *wq, unsigned int task_id, unsigned int priority,
+                    struct work_t *items, uint32_t length, unsigned int batch,
+                    void *stack, uint32_t stack_size);
+
+/**
+ * @brief Post work to a queue
+ *
+ * Never blocks. Can be called from tasks and from interrupt handlers
+ * whose priority is not higher than SCHEDULER_IRQ_PRIORITY.
+ *
+ * @param[in] wq
+ * @param[in] function Called by the worker task with arg
+ * @param[in] arg
+ * @return 0 if successful, -1 if the queue is full
+ */
+int workqueue_post(struct workqueue_t *wq, void (*function)(void *arg), void *arg);
+
+#endif
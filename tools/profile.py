@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+#
+# Print a flat profile from a dump of the profiler buffer, with the
+# functions sorted by number of samples.
+#
+# Dump the buffer with gdb:
+#   (gdb) dump binary memory profile.bin &profiler_buffer (char *)&profiler_buffer + sizeof(profiler_buffer)
+# or dump the whole RAM and pass its start address with --base.
+
+import argparse
+import bisect
+import collections
+import struct
+import subprocess
+import sys
+
+PROFILER_MAGIC = 0x50524F46
+PROFILER_HANDLER = 0xFF
+
+HEADER = struct.Struct('<IIII')
+ENTRY = struct.Struct('<IIII')
+
+
+def find_symbol(nm, elf, name):
+    output = subprocess.check_output([nm, '-S', elf], universal_newlines=True)
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[3] == name:
+            return int(fields[0], 16), int(fields[1], 16)
+    sys.exit('{}: symbol {} not found, does it call profiler_start?'.format(elf, name))
+
+
+class Symbolizer:
+    def __init__(self, nm, elf):
+        output = subprocess.check_output([nm, '-S', '-n', elf], universal_newlines=True)
+        self.functions = []
+        for line in output.splitlines():
+            fields = line.split()
+            if len(fields) == 4 and fields[2] in 'tTwW':
+                address = int(fields[0], 16) & ~1
+                self.functions.append((address, int(fields[1], 16), fields[3]))
+        self.addresses = [function[0] for function in self.functions]
+
+    def __call__(self, address):
+        address &= ~1
+        i = bisect.bisect_right(self.addresses, address) - 1
+        if i >= 0:
+            start, size, name = self.functions[i]
+            if address < start + size:
+                return name
+        return '0x{:08x}'.format(address)
+
+
+def read_entries(data):
+    magic, frequency, samples, dropped = HEADER.unpack_from(data)
+    if magic != PROFILER_MAGIC:
+        sys.exit('Invalid profiler buffer magic: 0x{:08x}'.format(magic))
+
+    entries = []
+    for offset in range(HEADER.size, len(data) - ENTRY.size + 1, ENTRY.size):
+        entry = ENTRY.unpack_from(data, offset)
+        if entry[3]:
+            entries.append(entry)
+    return frequency, samples, dropped, entries
+
+
+def task_name(task):
+    return 'interrupts' if task == PROFILER_HANDLER else 'task {}'.format(task)
+
+
+def print_table(title, counts, total, limit):
+    print('\n{:>7} {:>8}  {}'.format('%', 'samples', title))
+    for name, count in counts.most_common(limit):
+        print('{:7.2f} {:8}  {}'.format(100 * count / total, count, name))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Print a flat profile from a profiler buffer dump')
+    parser.add_argument('elf', help='firmware which ran the profiler')
+    parser.add_argument('dump', help='binary dump of profiler_buffer or of RAM')
+    parser.add_argument('--base', type=lambda x: int(x, 0),
+                        help='address of the first byte of a RAM dump')
+    parser.add_argument('--task', type=int, help='only count samples of this task')
+    parser.add_argument('--callers', action='store_true',
+                        help='also count samples by caller, from the sampled LR')
+    parser.add_argument('--limit', type=int, default=30, help='number of functions printed')
+    parser.add_argument('--nm', default='arm-none-eabi-nm')
+    args = parser.parse_args()
+
+    address, size = find_symbol(args.nm, args.elf, 'profiler_buffer')
+
+    with open(args.dump, 'rb') as f:
+        data = f.read()
+    if args.base is not None:
+        offset = address - args.base
+        data = data[offset:offset + size]
+    else:
+        data = data[:size]
+    if len(data) != size:
+        sys.exit('{}: profiler_buffer is not in the dump'.format(args.dump))
+
+    frequency, samples, dropped, entries = read_entries(data)
+    symbolize = Symbolizer(args.nm, args.elf)
+
+    functions = collections.Counter()
+    callers = collections.Counter()
+    tasks = collections.Counter()
+    for pc, lr, task, count in entries:
+        tasks[task_name(task)] += count
+        if args.task is not None and task != args.task:
+            continue
+        function = symbolize(pc)
+        functions[function] += count
+        callers['{} <- {}'.format(function, symbolize(lr))] += count
+
+    print('{} samples at {} Hz, {} dropped'.format(samples, frequency, dropped))
+    total = sum(functions.values())
+    if not total:
+        return
+
+    print_table('task', tasks, sum(tasks.values()), None)
+    print_table('function', functions, total, args.limit)
+    if args.callers:
+        print_table('function <- caller', callers, total, args.limit)
+
+
+if __name__ == '__main__':
+    main()
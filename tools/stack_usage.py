@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+#
+# Compute the worst case stack usage of each task from the call graphs
+# generated by gcc -fstack-usage -fcallgraph-info=su, and check it
+# against the stack size declared with TASK_DEFINE, or MAIN_STACK_LENGTH
+# for the main task.
+#
+# The worst case of a task is the deepest call chain from its entry
+# point, plus what the context switch and interrupts push on its stack:
+# an exception frame, with the FPU registers if the task may use the FPU,
+# and r4-r11 saved by pendsv_handler. Interrupt handlers themselves run
+# on the main stack.
+#
+# Indirect calls, calls to functions compiled without call graph
+# information (libgcc, newlib) and recursion cannot be bounded: they
+# are reported and counted as 0 bytes.
+
+import argparse
+import os
+import re
+import struct
+import subprocess
+import sys
+
+EXCEPTION_FRAME = 32
+FPU_EXCEPTION_FRAME = 104
+FRAME_ALIGNMENT = 4     # Padding added by the core to align the frame on 8 bytes
+SAVED_REGISTERS = 32    # r4-r11
+
+# Declared stacks larger than this many times the worst case are reported
+OVERSIZE_FACTOR = 4
+
+NODE = re.compile(r'node: \{ title: "([^"]+)" label: "([^"]+)"')
+EDGE = re.compile(r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+USAGE = re.compile(r'\\n(\d+) bytes \(([^)]*)\)')
+
+
+class CallGraph:
+    def __init__(self):
+        self.usage = {}
+        self.dynamic = set()
+        self.callees = {}
+
+    def load(self, path):
+        with open(path) as f:
+            for line in f:
+                match = NODE.match(line)
+                if match:
+                    title, label = match.groups()
+                    usage = USAGE.search(label)
+                    if usage:
+                        self.usage[title] = int(usage.group(1))
+                        if usage.group(2) != 'static':
+                            self.dynamic.add(title)
+                    continue
+                match = EDGE.match(line)
+                if match:
+                    source, target = match.groups()
+                    self.callees.setdefault(source, set()).add(target)
+
+    def find(self, name):
+        """Return the node of a function, static functions are prefixed by their file"""
+        if name in self.usage:
+            return name
+        matches = [title for title in self.usage if title.endswith(':' + name)]
+        if len(matches) == 1:
+            return matches[0]
+        return None
+
+    def depth(self, root):
+        """Return the worst case stack usage from root and the unbounded calls"""
+        memo = {}
+        unbounded = set()
+
+        def visit(node, path):
+            if node in memo:
+                return memo[node]
+            if node in path:
+                unbounded.add('recursion in ' + node)
+                return 0
+            if node == '__indirect_call':
+                unbounded.add('indirect calls')
+                return 0
+            if node not in self.usage:
+                unbounded.add(node)
+                return 0
+            if node in self.dynamic:
+                unbounded.add('dynamic stack in ' + node)
+
+            path.add(node)
+            deepest = 0
+            for callee in self.callees.get(node, ()):
+                deepest = max(deepest, visit(callee, path))
+            path.remove(node)
+
+            memo[node] = self.usage[node] + deepest
+            return memo[node]
+
+        return visit(root, set()), unbounded
+
+
+def read_symbols(nm, elf):
+    """Return function names by address and sizes of objects by name"""
+    output = subprocess.check_output([nm, '-S', elf], universal_newlines=True)
+    functions = {}
+    sizes = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) != 4:
+            continue
+        address, size, kind, name = int(fields[0], 16), int(fields[1], 16), fields[2], fields[3]
+        if kind in 'tT':
+            functions[address & ~1] = name
+        sizes[name] = size
+    return functions, sizes
+
+
+def read_section(objdump, elf, section):
+    """Return the contents of a section, or nothing if it is missing"""
+    result = subprocess.run([objdump, '-s', '-j', section, elf], stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL, universal_newlines=True)
+    data = bytearray()
+    for line in result.stdout.splitlines():
+        fields = line.split()
+        if not line.startswith(' ') or len(fields) < 2:
+            continue
+        for word in fields[1:5]:
+            if not re.fullmatch(r'[0-9a-f]{2,8}', word):
+                break
+            data += bytes.fromhex(word)
+    return bytes(data)
+
+
+def read_descriptors(elf, objdump, section):
+    """Return (id, entrypoint, stack_size) of tasks declared with TASK_DEFINE"""
+    with open(elf, 'rb') as f:
+        elf_class = f.read(5)[4]
+
+    # struct task_descriptor_t
+    if elf_class == 1:
+        descriptor = struct.Struct('<IIIIII')
+    else:
+        descriptor = struct.Struct('<I4xQQIIi4x')
+
+    data = read_section(objdump, elf, section)
+    for offset in range(0, len(data) - descriptor.size + 1, descriptor.size):
+        task_id, entrypoint, _, stack_size, _, _ = descriptor.unpack_from(data, offset)
+        yield task_id, entrypoint & ~1, stack_size
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Check task stack sizes against their worst case usage')
+    parser.add_argument('elf')
+    parser.add_argument('callgraphs', nargs='+', help='.ci files of all objects linked in elf')
+    parser.add_argument('--fpu', action='store_true',
+                        help='tasks may use the FPU: count the extended exception frame')
+    parser.add_argument('--section', default='.task', help='section of task descriptors')
+    parser.add_argument('--main', default='main', help='entry point of main task')
+    parser.add_argument('--nm', default='arm-none-eabi-nm')
+    parser.add_argument('--objdump', default='arm-none-eabi-objdump')
+    args = parser.parse_args()
+
+    graph = CallGraph()
+    for path in args.callgraphs:
+        if not os.path.exists(path):
+            sys.exit('{}: not found, was it built with -fcallgraph-info=su?'.format(path))
+        graph.load(path)
+
+    functions, sizes = read_symbols(args.nm, args.elf)
+
+    frame = FPU_EXCEPTION_FRAME if args.fpu else EXCEPTION_FRAME
+    overhead = frame + FRAME_ALIGNMENT + SAVED_REGISTERS
+
+    tasks = [(0, args.main, sizes.get('main_stack', 0))]
+    for task_id, entrypoint, stack_size in read_descriptors(args.elf, args.objdump, args.section):
+        tasks.append((task_id, functions.get(entrypoint, hex(entrypoint)), stack_size))
+
+    # A task returning from its entry point yields from stop_task
+    stop_task = graph.find('stop_task')
+    stop_depth, stop_unbounded = graph.depth(stop_task) if stop_task else (0, set())
+
+    failed = False
+    for task_id, name, stack_size in tasks:
+        node = graph.find(name)
+        if node is None:
+            print('task {} {}: no call graph information'.format(task_id, name))
+            continue
+
+        depth, unbounded = graph.depth(node)
+        depth = max(depth, stop_depth)
+        unbounded |= stop_unbounded
+        worst = depth + overhead
+        suggested = (worst + 7) & ~7
+
+        print('task {} {}: {} bytes, worst case {} bytes ({} in calls + {} for interrupts)'
+              .format(task_id, name, stack_size, worst, depth, overhead))
+        if unbounded:
+            print('    not counted: {}'.format(', '.join(sorted(unbounded))))
+
+        if stack_size < worst:
+            print('error: task {} {}: stack too small, use at least {} bytes'
+                  .format(task_id, name, suggested))
+            failed = True
+        elif stack_size > OVERSIZE_FACTOR * suggested:
+            print('warning: task {} {}: stack larger than needed, {} bytes would do'
+                  .format(task_id, name, suggested))
+
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+#
+# Convert a dump of the scheduler trace buffer to Chrome trace JSON,
+# which can be opened in chrome://tracing or https://ui.perfetto.dev
+#
+# Dump the buffer with gdb:
+#   (gdb) dump binary memory trace.bin &trace_buffer (char *)&trace_buffer + sizeof(trace_buffer)
+# or dump the whole RAM and pass its start address with --base.
+
+import argparse
+import json
+import struct
+import subprocess
+import sys
+
+TRACE_MAGIC = 0x54524345
+
+TRACE_SWITCH = 1
+TRACE_READY = 2
+TRACE_BLOCK = 3
+TRACE_ISR_ENTER = 4
+TRACE_ISR_EXIT = 5
+TRACE_TIMER = 6
+
+ISR_TID = 1000
+
+HEADER = struct.Struct('<II')
+RECORD = struct.Struct('<IBBH')
+
+
+def find_symbol(nm, elf, name):
+    output = subprocess.check_output([nm, '-S', elf], universal_newlines=True)
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[3] == name:
+            return int(fields[0], 16), int(fields[1], 16)
+    sys.exit('{}: symbol {} not found, was it built with TRACE=1?'.format(elf, name))
+
+
+def read_records(data):
+    magic, index = HEADER.unpack_from(data)
+    if magic != TRACE_MAGIC:
+        sys.exit('Invalid trace buffer magic: 0x{:08x}'.format(magic))
+
+    length = (len(data) - HEADER.size) // RECORD.size
+    count = min(index, length)
+    for i in range(index - count, index):
+        record = RECORD.unpack_from(data, HEADER.size + (i % length) * RECORD.size)
+        # Skip records reserved but not written yet when the dump was taken
+        if record[1] != 0:
+            yield record
+
+
+def unwrap(records):
+    """Return records with timestamps in cycles from the first record, in time order"""
+    unwrapped = []
+    time = 0
+    last = None
+
+    for timestamp, event, task, arg in records:
+        # The cycle counter wraps around every 2^32 cycles. An interrupt
+        # handler can write the next record between the reservation of a
+        # record and its timestamp, so a delta can be slightly negative.
+        if last is not None:
+            delta = (timestamp - last) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000
+            time += delta
+        last = timestamp
+        unwrapped.append((time, event, task, arg))
+
+    unwrapped.sort(key=lambda record: record[0])
+    return unwrapped
+
+
+def convert(records, freq):
+    events = []
+    tasks = set()
+    running = None
+    ts = 0
+
+    for time, event, task, arg in unwrap(records):
+        ts = time * 1e6 / freq
+
+        if event == TRACE_SWITCH:
+            if running is not None:
+                events.append({'name': 'task {}'.format(running), 'ph': 'E',
+                               'pid': 0, 'tid': running, 'ts': ts})
+            events.append({'name': 'task {}'.format(task), 'ph': 'B',
+                           'pid': 0, 'tid': task, 'ts': ts})
+            running = task
+            tasks.update((task, arg))
+        elif event in (TRACE_READY, TRACE_BLOCK, TRACE_TIMER):
+            name = {
+                TRACE_READY: 'wake' if arg else 'ready',
+                TRACE_BLOCK: 'block',
+                TRACE_TIMER: 'timer {}'.format(arg),
+            }[event]
+            events.append({'name': name, 'ph': 'i', 's': 't',
+                           'pid': 0, 'tid': task, 'ts': ts})
+            tasks.add(task)
+        elif event in (TRACE_ISR_ENTER, TRACE_ISR_EXIT):
+            events.append({'name': 'IRQ {}'.format(arg - 16),
+                           'ph': 'B' if event == TRACE_ISR_ENTER else 'E',
+                           'pid': 0, 'tid': ISR_TID, 'ts': ts,
+                           'args': {'task': task}})
+
+    if running is not None:
+        events.append({'name': 'task {}'.format(running), 'ph': 'E',
+                       'pid': 0, 'tid': running, 'ts': ts})
+
+    for task in sorted(tasks):
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': task,
+                       'args': {'name': 'task {}'.format(task)}})
+    events.append({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': ISR_TID,
+                   'args': {'name': 'interrupts'}})
+
+    return {'traceEvents': events}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a scheduler trace dump to Chrome trace JSON')
+    parser.add_argument('elf', help='firmware built with TRACE=1')
+    parser.add_argument('dump', help='binary dump of trace_buffer or of RAM')
+    parser.add_argument('--base', type=lambda x: int(x, 0),
+                        help='address of the first byte of a RAM dump')
+    parser.add_argument('--freq', type=float, default=1e6,
+                        help='core clock in Hz (default: timestamps in cycles)')
+    parser.add_argument('--nm', default='arm-none-eabi-nm')
+    parser.add_argument('-o', '--output', default='-')
+    args = parser.parse_args()
+
+    address, size = find_symbol(args.nm, args.elf, 'trace_buffer')
+
+    with open(args.dump, 'rb') as f:
+        data = f.read()
+    if args.base is not None:
+        offset = address - args.base
+        data = data[offset:offset + size]
+    else:
+        data = data[:size]
+    if len(data) != size:
+        sys.exit('{}: trace_buffer is not in the dump'.format(args.dump))
+
+    trace = convert(read_records(data), args.freq)
+
+    if args.output == '-':
+        json.dump(trace, sys.stdout)
+    else:
+        with open(args.output, 'w') as f:
+            json.dump(trace, f)
+
+
+if __name__ == '__main__':
+    main()